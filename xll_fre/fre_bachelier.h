@@ -2,6 +2,9 @@
 // https://keithalewis.github.io/math/bach.html
 // Price is F_t = f + σ B_t, B_t standard Brownian motion.
 #pragma once
+#include <limits>
+#include <span>
+#include "../xll/xll/ensure.h"
 #include "fre_normal.h"
 #ifdef _DEBUG
 #include <cassert>
@@ -16,6 +19,40 @@ namespace fre::bachelier {
 		return (k - f) / (σ * sqrt(t));
 	}
 
+	// Out-of-the-money value is |f - k| tilde(-|f - k|/(σ sqrt(t))) where
+	// tilde(x) = Φ(x) + ϕ(x)/x < 0 for x < 0.
+	inline double tilde(double x)
+	{
+		return normal::cdf(x) + normal::pdf(x) / x;
+	}
+
+	// Solve tilde(x) = y for x < 0 without iteration using a rational approximation
+	// followed by one Householder step of order 4.
+	// P. Jäckel, "Implied Normal Volatility", Wilmott (2017).
+	inline double tilde_inverse(double y)
+	{
+		double x;
+
+		if (y < -0.001882039271) {
+			double g = 1 / (y - 0.5);
+			double g2 = g * g;
+			double xi = (0.032114372355 - g2 * (0.016969777977 - g2 * (2.6207332461e-3 - 9.6066952861e-5 * g2)))
+				/ (1 - g2 * (0.6635646938 - g2 * (0.14528712196 - 0.010472855461 * g2)));
+			x = g * (normal::M_1_SQRT2PI + xi * g2);
+		}
+		else {
+			double h = sqrt(-log(-y));
+			x = (9.4883409779 - h * (9.6320903635 - h * (0.58556997323 + 2.1464093351 * h)))
+				/ (1 - h * (0.65174820867 + h * (1.5120247828 + 6.6437847132e-5 * h)));
+		}
+
+		double q = (tilde(x) - y) / normal::pdf(x);
+		double x2 = x * x;
+
+		return x + 3 * q * x2 * (2 - q * x * (2 + x2))
+			/ (6 + q * x * (-12 + x * (6 * q + x * (-6 + q * x * (3 + x2)))));
+	}
+
 	namespace put {
 
 		// E[(k - F)^+] = (k − F) Φ(z) + σ sqrt(t) ϕ(z)
@@ -26,6 +63,57 @@ namespace fre::bachelier {
 			return (k - f) * normal::cdf(z) + σ * sqrt(t) * normal::pdf(z);
 		}
 
+		// Return σ with p = value(f, σ, k, t), or NaN if p is not in [max(k - f, 0), infinity).
+		inline double implied(double f, double p, double k, double t)
+		{
+			// out-of-the-money price: put if k <= f, otherwise call by put-call parity
+			double p_ = k <= f ? p : p - (k - f);
+
+			if (!(p_ >= 0)) {
+				return std::numeric_limits<double>::quiet_NaN();
+			}
+			if (f == k) {
+				return p / (normal::M_1_SQRT2PI * sqrt(t));
+			}
+			if (p_ == 0) {
+				return 0;
+			}
+
+			double x = tilde_inverse(-p_ / fabs(f - k));
+
+			return fabs(f - k) / (-x * sqrt(t));
+		}
+		// σ[i] = implied(f[i], p[i], k[i], t[i])
+		inline void implied(std::span<const double> f, std::span<const double> p, std::span<const double> k,
+			std::span<const double> t, std::span<double> σ)
+		{
+			ensure(p.size() == f.size() && k.size() == f.size() && t.size() == f.size() && σ.size() == f.size());
+
+			for (size_t i = 0; i < f.size(); ++i) {
+				σ[i] = implied(f[i], p[i], k[i], t[i]);
+			}
+		}
+#ifdef _DEBUG
+		inline int implied_test()
+		{
+			// out-of-the-money puts
+			double f = 0.03, t = 2;
+			for (double k = 0.0; k <= f; k += 0.0025) {
+				for (double σ = 0.0001; σ <= 0.03; σ *= 1.2) {
+					double p = value(f, σ, k, t);
+					if (p > 1e-12 * f) { // price resolves vol
+						double σ_ = implied(f, p, k, t);
+						assert(fabs(σ_ - σ) <= 1e-10 * σ);
+					}
+				}
+			}
+			assert(std::isnan(implied(f, -1, f, t)));
+			assert(0 == implied(1, 0.5, 1.5, t));
+
+			return 0;
+		}
+#endif // _DEBUG
+
 #ifdef _DEBUG
 		int value_test()
 		{
@@ -4,11 +4,14 @@
 #include <cassert>
 #endif // _DEBUG
 #include "../xll/xll/ensure.h"
+#include <algorithm>
 #include <cmath>
-#include <map>
+#include <concepts>
 #include <numeric>
 #include <functional>
 #include <iterator>
+#include <limits>
+#include <vector>
 
 namespace fre::binomial {
 
@@ -114,17 +117,122 @@ namespace fre::binomial {
 		return E;
 	}
 #endif 	
-	// E[f(V_N)|V_n = k] = (E[f(V_N)|V_n = k, V_{n+1} = k] + E[f(V_N)|V_n = k, V_{n+1} = k+1])/2
-	constexpr double random_walk(const std::function<double(double)>& f, size_t N, size_t n, size_t k)
-	{
-		ensure(n <= N);
-		ensure(k <= n);
+	// Backward induction on the random walk lattice V_n = k, 0 <= k <= n <= N.
+	// Node values for one time step are rolled in place in a single buffer,
+	// so pricing takes O(N^2) time and O(N) memory.
+	class lattice {
+		std::vector<double> v; // node values at current time step
+
+		// Roll f(x(i, j)) back from step m to 0 with one period discount D, where j counts up moves.
+		// Early exercise takes the larger of f(x(i, j)) and the continuation value at every node.
+		template<bool early, class F, class X>
+		double rollback(const F& f, const X& x, size_t m, double D)
+		{
+			v.resize(m + 1);
+			for (size_t j = 0; j <= m; ++j) {
+				v[j] = f(x(m, j));
+			}
+			for (size_t i = m; i > 0; --i) {
+				for (size_t j = 0; j < i; ++j) {
+					double c = D * (v[j] + v[j + 1]) / 2;
+					if constexpr (early) {
+						v[j] = std::max(f(x(i - 1, j)), c);
+					}
+					else {
+						v[j] = c;
+					}
+				}
+			}
 
-		if (n == N) {
-			return f(1.*k);
+			return v[0];
+		}
+	public:
+		explicit lattice(size_t N = 0)
+		{
+			v.reserve(N + 1);
 		}
+		lattice(const lattice&) = default;
+		lattice& operator=(const lattice&) = default;
+		~lattice() = default;
 
-		return (random_walk(f, N, n + 1, k + 1) + random_walk(f, N, n + 1, k)) / 2;
+		size_t capacity() const
+		{
+			return v.capacity();
+		}
+
+		// E[f(V_N)|V_n = k]
+		template<class F>
+		double european(const F& f, size_t N, size_t n = 0, size_t k = 0)
+		{
+			ensure(n <= N);
+			ensure(k <= n);
+
+			// V_N in {k, ..., k + N - n} given V_n = k
+			// E[f(V_N)|V_i = j] = (E[f(V_N)|V_{i+1} = j] + E[f(V_N)|V_{i+1} = j + 1])/2
+			return rollback<false>(f, [k](size_t, size_t j) { return 1. * (k + j); }, N - n, 1);
+		}
+
+		// max_{tau <= N} E[f(V_tau) | tau >= n, V_n = k]
+		template<class F>
+		double american(const F& f, size_t N, size_t n = 0, size_t k = 0)
+		{
+			ensure(n <= N);
+			ensure(k <= n);
+
+			return rollback<true>(f, [k](size_t, size_t j) { return 1. * (k + j); }, N - n, 1);
+		}
+		// max_{tau <= N} E[D^tau f(x(tau, V_tau))] for an underlying x(n, k) on the lattice
+		template<class F, class X>
+			requires std::invocable<const X&, size_t, size_t>
+		double american(const F& f, const X& x, size_t N, double D)
+		{
+			return rollback<true>(f, x, N, D);
+		}
+	};
+
+	// Payoffs of V_N known at compile time so lattice loops can inline them.
+	namespace payoff {
+
+		// (k - x)^+
+		struct put {
+			double k;
+			constexpr double operator()(double x) const
+			{
+				return k > x ? k - x : 0;
+			}
+		};
+		// (x - k)^+
+		struct call {
+			double k;
+			constexpr double operator()(double x) const
+			{
+				return x > k ? x - k : 0;
+			}
+		};
+		// 1(x > k)
+		struct digital {
+			double k;
+			constexpr double operator()(double x) const
+			{
+				return x > k ? 1. : 0.;
+			}
+		};
+		// x^a
+		struct power {
+			double a;
+			double operator()(double x) const
+			{
+				return std::pow(x, a);
+			}
+		};
+
+	} // namespace payoff
+
+	// E[f(V_N)|V_n = k] = (E[f(V_N)|V_n = k, V_{n+1} = k] + E[f(V_N)|V_n = k, V_{n+1} = k+1])/2
+	template<class F>
+	inline double random_walk(const F& f, size_t N, size_t n, size_t k)
+	{
+		return lattice(N).european(f, N, n, k);
 	}
 #ifdef _DEBUG
 	inline int random_walk_test()
@@ -138,24 +246,40 @@ namespace fre::binomial {
 			assert(2 == random_walk([](double x) { return x; }, 3, 3, 2));
 			assert(3 == random_walk([](double x) { return x; }, 3, 3, 3));
 		}
+		{
+			// E[V_N|V_n = k] = k + (N - n)/2
+			lattice l(100);
+			assert(50 == l.european([](double x) { return x; }, 100));
+			assert(5 + 45 == l.european([](double x) { return x; }, 100, 10, 5));
+			assert(l.capacity() >= 101);
+		}
+		{
+			// built-in payoffs agree with std::function
+			lattice l(20);
+			for (double k : { 0., 5., 10.5, 20. }) {
+				const std::function<double(double)> p = payoff::put{ k };
+				const std::function<double(double)> c = payoff::call{ k };
+				assert(l.european(payoff::put{ k }, 20) == l.european(p, 20));
+				assert(l.european(payoff::call{ k }, 20) == l.european(c, 20));
+				// put-call parity E[(k - V)^+] - E[(V - k)^+] = k - E[V]
+				double pc = l.european(payoff::put{ k }, 20) - l.european(payoff::call{ k }, 20);
+				assert(fabs(pc - (k - 10)) < 1e-12);
+			}
+			// P(V_20 = 10) = C(20, 10)/2^20
+			double d = l.european(payoff::digital{ 9.5 }, 20) - l.european(payoff::digital{ 10.5 }, 20);
+			assert(fabs(d - 184756. / (1 << 20)) < 1e-15);
+			assert(l.european(payoff::power{ 1 }, 20) == 10);
+		}
 
 		return 0;
 	}
 #endif // _DEBUG
 	
 	// max_{tau <= N} E[f(V_tau) | tau >== n, V_n = k]
-	constexpr double american_random_walk(const std::function<double(double)>& f, size_t N, size_t n, size_t k)
+	template<class F>
+	inline double american_random_walk(const F& f, size_t N, size_t n, size_t k)
 	{
-		ensure(n <= N);
-		ensure(k <= n);
-
-		if (n == N) {
-			return f(1.*k);
-		}
-		
-		double v = (american_random_walk(f, N, n + 1, k) + american_random_walk(f, N, n + 1, k + 1))/ 2;
-		
-		return std::max(f(1.*k), v);
+		return lattice(N).american(f, N, n, k);
 	}
 #ifdef _DEBUG
 	inline int american_random_walk_test()
@@ -191,8 +315,8 @@ namespace fre::binomial {
 #endif // _DEBUG
 
 	// S_t = S0 exp(rt + sigma B_t - sigma^2 t/2)
-	//    ~= S0 exp(rt + s W_n)/cosh^n s), t = N dt, s^2 n = sigma^2 t, W_n = 2 V_n - n.
-	// Approximate the American put value E[max{k - F_t}, 0}] with binomial step size dt.
+	//    ~= S0 exp(rt + s W_n)/cosh^n s, t = n dt, s^2 = sigma^2 dt, W_n = 2 V_n - n.
+	// Approximate the American put value max_tau E[max{k - S_tau, 0} exp(-r tau)] with binomial step size dt.
 	inline double american_put_value(double r, double S0, double sigma, double k, double t, double dt)
 	{
 		ensure(dt > 0);
@@ -200,37 +324,147 @@ namespace fre::binomial {
 		ensure(dt <= t);
 
 		size_t N = static_cast<size_t>(t / dt);
-		double s = sigma * sqrt(t);
-		// !!!Fix CodePilot generated code.
-		//const auto f = [r, S0, s, k](double x) { return std::max(k - S0 * exp(r * x), 0.); };
-		const auto f = [r, S0, s, k, t](double x) { return std::max(k - S0 * exp(r + s * x), 0.); };
-		
-		return american_random_walk(f, N, 0, 0);
+		dt = t / N; // N steps exactly cover [0, t]
+		double s = sigma * sqrt(dt);
+		double D = exp(-r * dt); // one period discount
+		double u2 = exp(2 * s); // S_n(k + 1) = S_n(k) exp(2s)
+		// S_n(0) = S0 exp(r n dt - s n)/cosh^n s
+		double R = exp(r * dt - s) / cosh(s);
+
+		// S_n(j) = S0 R^n u2^j
+		std::vector<double> Rn(N + 1), u2j(N + 1);
+		for (size_t j = 0; j <= N; ++j) {
+			Rn[j] = S0 * pow(R, 1. * j);
+			u2j[j] = pow(u2, 1. * j);
+		}
+		auto S = [&Rn, &u2j](size_t n, size_t j) { return Rn[n] * u2j[j]; };
+
+		return lattice(N).american(payoff::put{ k }, S, N, D);
+	}
+#ifdef _DEBUG
+	inline int american_put_value_test()
+	{
+		{
+			// American put is at least the intrinsic value
+			double v = american_put_value(0.05, 100, 0.2, 100, 1, 1./252);
+			assert(v > 0);
+			assert(american_put_value(0.05, 50, 0.2, 100, 1, 1./252) >= 50);
+		}
+		{
+			// daily steps over several years
+			double v = american_put_value(0.05, 100, 0.2, 100, 10, 1./252);
+			assert(v > 0 && v < 100);
+		}
+		{
+			// r = 0 never exercises early and converges to Black
+			double v1 = american_put_value(0, 100, 0.2, 100, 1, 1./1000);
+			double v2 = american_put_value(0, 100, 0.2, 100, 1, 1./2000);
+			assert(fabs(v1 - v2) < 0.01);
+			assert(fabs(v1 - 7.9656) < 0.01); // black::put::value(100, 0.2, 100)
+		}
+
+		return 0;
 	}
+#endif // _DEBUG
 
-	// Remember previous calls of n and k.
+	// Remember previous calls of n and k, 0 <= k <= n.
+	// Values are stored densely by row, (n, k) -> n(n + 1)/2 + k, and NaN marks an empty slot.
+	// Rows are appended as larger n are requested so existing values never move.
+	template<class F = std::function<double(size_t, size_t)>>
 	class memoize {
-		std::map<std::pair<size_t, size_t>, double> m; // remember previous calls
-		std::function<double(size_t, size_t)> f;
+		static constexpr double empty = std::numeric_limits<double>::quiet_NaN();
+		std::vector<double> m; // remember previous calls
+		size_t N; // rows 0, ..., N
+		F f;
+
+		static constexpr size_t index(size_t n, size_t k)
+		{
+			return n * (n + 1) / 2 + k;
+		}
 	public:
-		memoize(std::function<double(size_t, size_t)> f)
-			: f(std::move(f))
+		// Reserve space for 0 <= k <= n <= N.
+		memoize(F f, size_t N = 0)
+			: m(index(N + 1, 0), empty), N(N), f(std::move(f))
 		{ }
+
+		// Largest n with space reserved.
+		size_t size() const
+		{
+			return N;
+		}
+
+		// Forget previous calls without releasing memory.
+		memoize& reset()
+		{
+			std::fill(m.begin(), m.end(), empty);
+
+			return *this;
+		}
+		// Forget previous calls and use a new function.
+		memoize& reset(F f_)
+		{
+			f = std::move(f_);
+
+			return reset();
+		}
+
 		double operator()(size_t n, size_t k)
 		{
-			double fnk;
+			ensure(k <= n);
 
-			const auto i = m.find({ n, k }); // {key, value}
-			if (i == m.end()) {
-				fnk = f(n, k);
-				m[{n, k}] = fnk;
+			if (n > N) {
+				m.resize(index(n + 1, 0), empty);
+				N = n;
 			}
-			else {
-				fnk = i->second;
+			size_t i = index(n, k);
+			if (std::isnan(m[i])) {
+				double fnk = f(n, k); // might grow m
+				m[i] = fnk;
 			}
 
-			return fnk;
+			return m[i];
 		}
 	};
+#ifdef _DEBUG
+	inline int memoize_test()
+	{
+		{
+			size_t calls = 0;
+			memoize m([&calls](size_t n, size_t k) { ++calls; return 1. * n * k; }, 3);
+			assert(3 == m.size());
+			assert(4 == m(2, 2));
+			assert(1 == calls);
+			assert(4 == m(2, 2));
+			assert(1 == calls);
+			assert(2 == m(2, 1));
+			assert(2 == calls);
+			assert(50 == m(10, 5)); // grow past N
+			assert(10 == m.size());
+			assert(3 == calls);
+			assert(2 == m(2, 1));
+			assert(3 == calls);
+			m.reset();
+			assert(10 == m.size());
+			assert(2 == m(2, 1));
+			assert(4 == calls);
+		}
+		{
+			// memoized recursion agrees with lattice
+			size_t N = 50;
+			std::function<double(size_t, size_t)> rw;
+			memoize<> m([&rw](size_t n, size_t k) { return rw(n, k); }, N);
+			for (double k : { 10., 25., 40. }) {
+				rw = [&m, N, k](size_t n, size_t j) {
+					return n == N ? payoff::put{ k }(1. * j) : (m(n + 1, j) + m(n + 1, j + 1)) / 2;
+				};
+				m.reset();
+				assert(fabs(m(0, 0) - lattice(N).european(payoff::put{ k }, N)) < 1e-12);
+				assert(N == m.size());
+			}
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
 
 } // namespace fre::binomial
@@ -2,9 +2,15 @@
 // Price at expiration is F = f exp(s Z - s^2/2), Z standard normal.
 // Note E[F] = f and Var(log F) = s^2.
 #pragma once
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <tuple>
+#include "../xll/xll/ensure.h"
 #include "fre_normal.h"
 #ifdef _DEBUG
 #include <cassert>
+#include <vector>
 #include "fre_test.h"
 #endif // _DEBUG
 
@@ -19,6 +25,138 @@ namespace fre::black {
 		return log(k / f) / s + s / 2;
 	}
 
+	// Value and first order sensitivities. Black has no time or rate so theta and rho are 0.
+	struct sensitivity {
+		double value, delta, gamma, vega, theta, rho;
+	};
+
+	// Prices in units of sqrt(f k) depend only on x = log(f/k) and s.
+	// P. Jaeckel, "Let's Be Rational", Wilmott (2015).
+	namespace normalized {
+
+		// Out-of-the-money call value e^{x/2} P(Z <= x/s + s/2) - e^{-x/2} P(Z <= x/s - s/2), x <= 0.
+		inline double value(double x, double s)
+		{
+			return exp(x / 2) * normal::cdf(x / s + s / 2) - exp(-x / 2) * normal::cdf(x / s - s / 2);
+		}
+		// (d/ds) value(x, s)
+		inline double vega(double x, double s)
+		{
+			return normal::M_1_SQRT2PI * exp(-x * x / (2 * s * s) - s * s / 8);
+		}
+
+		// Cubic with p(0) = p0, p'(0) = m0, p(1) = p1, p'(1) = m1
+		inline double hermite(double t, double p0, double m0, double p1, double m1)
+		{
+			double t2 = t * t;
+			double t3 = t2 * t;
+
+			return (2 * t3 - 3 * t2 + 1) * p0 + (t3 - 2 * t2 + t) * m0 + (-2 * t3 + 3 * t2) * p1 + (t3 - t2) * m1;
+		}
+
+		// Tangents to value(x, s) at the inflection point s_c = sqrt(2|x|) hit 0 at s_l
+		// and the upper bound e^{x/2} at s_u. Let b_l, b_c, b_u be the corresponding values.
+		struct branches {
+			double x, ex, sl, sc, su, bl, bc, bu;
+
+			branches(double x)
+				: x(x), ex(exp(x / 2)), sl(0), sc(sqrt(-2 * x)), su(0), bl(0), bc(0), bu(0)
+			{
+				if (x != 0) {
+					bc = value(x, sc);
+					double vc = vega(x, sc);
+					sl = sc - bc / vc;
+					su = sc + (ex - bc) / vc;
+					bl = sl > 0 ? value(x, sl) : 0;
+					bu = value(x, su);
+				}
+			}
+
+			// Initial guess for s with b = value(x, s). Use cubic Hermite interpolation
+			// of the inverse on [b_l, b_u] and asymptotic maps outside.
+			double guess(double b) const
+			{
+				if (x == 0) {
+					// value(0, s) = 1 - 2 P(Z <= -s/2)
+					return -2 * normal::inv((1 - b) / 2);
+				}
+				if (b < bl) {
+					// value(x, s) ~ 2 pi |x|/(3 sqrt(3)) P(Z <= x/(sqrt(3) s))^3 as s -> 0
+					double z = normal::inv(cbrt(3 * sqrt(3.) * b / (-2 * M_PI * x)));
+
+					return std::min(x / (sqrt(3.) * z), sl);
+				}
+				if (b <= bu) {
+					// s(b) with s(b_0) = s_0, s(b_1) = s_1, s'(b_0) = 1/value'(s_0), s'(b_1) = 1/value'(s_1)
+					auto [b0, s0, b1, s1] = b <= bc ? std::tuple(bl, sl, bc, sc) : std::tuple(bc, sc, bu, su);
+					double m0 = s0 > 0 ? (b1 - b0) / vega(x, s0) : s1 - s0;
+					double m1 = (b1 - b0) / vega(x, s1);
+
+					return hermite((b - b0) / (b1 - b0), s0, m0, s1, m1);
+				}
+
+				// e^{x/2} - value(x, s) ~ (e^{x/2} + e^{-x/2}) P(Z <= -s/2) as s -> infinity
+				// Interpolate u = P(Z <= -s/2) as a function of y = e^{x/2} - b on [0, y_u].
+				double yu = ex - bu;
+				double uu = normal::cdf(-su / 2);
+				double m0 = yu / (ex + 1 / ex);
+				double m1 = yu * normal::pdf(su / 2) / (2 * vega(x, su));
+				double u = hermite((ex - b) / yu, 0, m0, uu, m1);
+
+				return -2 * normal::inv(u);
+			}
+		};
+
+		// Vol s with b = value(x, s), x <= 0, using N Householder steps of order 3.
+		// The objective is log b below b_l, b in [b_l, b_u], and log(e^{x/2} - b) above b_u.
+		inline double implied(double x, double b, size_t N = 2)
+		{
+			ensure(x <= 0);
+
+			if (!(b >= 0 && b < exp(x / 2))) {
+				return NaN;
+			}
+			if (b == 0) {
+				return 0;
+			}
+
+			const branches br(x);
+			double s = br.guess(b);
+
+			for (size_t i = 0; i < N; ++i) {
+				double v = value(x, s);
+				double dv = vega(x, s);
+				double h2 = x * x / (s * s * s) - s / 4; // value''/value'
+				double h3 = h2 * h2 - 3 * x * x / (s * s * s * s) - 0.25; // value'''/value'
+
+				double g, g1, g2, g3; // objective and its derivatives
+				if (b < br.bl || b > br.bu) {
+					// g = log w(s) - log w*, l = w'/w
+					double l = b < br.bl ? dv / v : -dv / (br.ex - v);
+					g = b < br.bl ? log(v / b) : log((br.ex - v) / (br.ex - b));
+					g1 = l;
+					g2 = l * h2 - l * l;
+					g3 = l * h3 - 3 * l * l * h2 + 2 * l * l * l;
+				}
+				else {
+					g = v - b;
+					g1 = dv;
+					g2 = dv * h2;
+					g3 = dv * h3;
+				}
+
+				// s' = s + nu (1 + h2 nu/2)/(1 + nu (h2 + h3 nu/6)), nu = -g/g'
+				double nu = -g / g1;
+				double h2_ = g2 / g1;
+				double h3_ = g3 / g1;
+				s += nu * (1 + h2_ * nu / 2) / (1 + nu * (h2_ + h3_ * nu / 6));
+			}
+
+			return s;
+		}
+
+	} // namespace normalized
+
 	namespace put {
 
 		// E[(k - F)^+] = k P(F <= k) - f P^s(F <= k)
@@ -43,6 +181,13 @@ namespace fre::black {
 
 			return f*normal::pdf(m, s);
 		}
+		// (d/df) delta = -(d/df) P(Z <= m - s) = ϕ(m - s)/(f s)
+		inline double gamma(double f, double s, double k)
+		{
+			double m = moneyness(f, k, s);
+
+			return normal::pdf(m, s) / (f * s);
+		}
 #ifdef _DEBUG
 		inline int vega_test()
 		{
@@ -58,22 +203,15 @@ namespace fre::black {
 			return 0;
 		}
 #endif // _DEBUG
-		// Return vol s with p = value(f, s, k)
-		inline double implied(double f, double p, double k,
-			double eps = sqrt(epsilon), size_t N = 100, double s = 0.1)
+		// Return vol s with p = value(f, s, k) using N Householder steps.
+		// Return NaN if p is not in [max(k - f, 0), k).
+		inline double implied(double f, double p, double k, size_t N = 2)
 		{
-			while (fabs(p - value(f, s, k)) > eps) {
-				if (N-- == 0) {
-					return NaN;
-				}
-				double s_ = s - (value(f, s, k) - p) / vega(f, s, k); // Newton-Raphson x' = x - f(x)/f'(x)
-				if (s_ < 0) {
-					s_ = s / 2;
-				}
-				std::swap(s_, s);
-			}
+			double x = log(f / k);
+			// out-of-the-money price: put if k <= f, otherwise call by put-call parity
+			double b = (k <= f ? p : p + f - k) / sqrt(f * k);
 
-			return s;
+			return normalized::implied(-fabs(x), b, N);
 		}
 #ifdef _DEBUG
 		inline int implied_test()
@@ -84,6 +222,156 @@ namespace fre::black {
 				s = implied(f, p, k);
 				assert(fabs(p - value(f, s, k)) < sqrt(epsilon));
 			}
+			{
+				// out-of-the-money puts over a wide moneyness and vol grid
+				for (double k : { 1., 10., 50., 90., 100. }) {
+					for (double s = 0.01; s <= 3; s *= 1.1) {
+						double p = value(100, s, k);
+						if (p > 1e-12 * k) { // price resolves vol
+							double s_ = implied(100, p, k);
+							assert(fabs(s_ - s) <= 1e-10 * s);
+						}
+					}
+				}
+			}
+			{
+				assert(std::isnan(implied(100, -1, 100)));
+				assert(std::isnan(implied(100, 101, 100)));
+				assert(0 == implied(100, 10, 110));
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
+		// s[i] = implied(f[i], p[i], k[i])
+		inline void implied(std::span<const double> f, std::span<const double> p, std::span<const double> k,
+			std::span<double> s, size_t N = 2)
+		{
+			ensure(p.size() == f.size() && k.size() == f.size() && s.size() == f.size());
+
+			for (size_t i = 0; i < f.size(); ++i) {
+				s[i] = implied(f[i], p[i], k[i], N);
+			}
+		}
+
+		// Values, deltas, and vegas of puts given structure-of-arrays forwards, vols, and strikes.
+		// Empty d or dv spans are not computed. Moneyness and both cdf values are computed once
+		// per option into small block buffers that are reused for the value, delta, and vega.
+		inline void batch(std::span<const double> f, std::span<const double> s, std::span<const double> k,
+			std::span<double> v, std::span<double> d = {}, std::span<double> dv = {})
+		{
+			const size_t n = f.size();
+			ensure(s.size() == n && k.size() == n && v.size() == n);
+			ensure(d.size() == 0 || d.size() == n);
+			ensure(dv.size() == 0 || dv.size() == n);
+
+			constexpr size_t block = 256;
+			double m[block]; // moneyness
+			double N0[block]; // P(Z <= m)
+			double N1[block]; // P(Z <= m - s)
+
+			for (size_t i = 0; i < n; i += block) {
+				const size_t nb = std::min(block, n - i);
+				const double* fi = f.data() + i;
+				const double* si = s.data() + i;
+				const double* ki = k.data() + i;
+
+				for (size_t j = 0; j < nb; ++j) {
+					m[j] = log(ki[j] / fi[j]) / si[j] + si[j] / 2;
+				}
+				for (size_t j = 0; j < nb; ++j) {
+					N0[j] = normal::cdf(m[j]);
+					N1[j] = normal::cdf(m[j], si[j]);
+				}
+				double* vi = v.data() + i;
+				for (size_t j = 0; j < nb; ++j) {
+					vi[j] = ki[j] * N0[j] - fi[j] * N1[j];
+				}
+				if (d.size()) {
+					double* di = d.data() + i;
+					for (size_t j = 0; j < nb; ++j) {
+						di[j] = -N1[j];
+					}
+				}
+				if (dv.size()) {
+					double* dvi = dv.data() + i;
+					for (size_t j = 0; j < nb; ++j) {
+						dvi[j] = fi[j] * normal::pdf(m[j], si[j]);
+					}
+				}
+			}
+		}
+#ifdef _DEBUG
+		inline int batch_test()
+		{
+			constexpr size_t n = 1000; // more than one block
+			std::vector<double> f(n), s(n), k(n), v(n), d(n), dv(n);
+			for (size_t i = 0; i < n; ++i) {
+				f[i] = 100;
+				s[i] = 0.01 + i * 1. / n;
+				k[i] = 50 + (i % 101);
+			}
+			batch(f, s, k, v, d, dv);
+			// agree with scalar functions to 8 ulp of the strike
+			for (size_t i = 0; i < n; ++i) {
+				assert(fabs(v[i] - value(f[i], s[i], k[i])) <= 8 * epsilon * k[i]);
+				assert(fabs(d[i] - delta(f[i], s[i], k[i])) <= 8 * epsilon);
+				assert(fabs(dv[i] - vega(f[i], s[i], k[i])) <= 8 * epsilon * f[i]);
+			}
+			// value only
+			std::vector<double> v_(n);
+			batch(f, s, k, v_);
+			assert(v == v_);
+
+			return 0;
+		}
+#endif // _DEBUG
+
+		// Value, delta, gamma, and vega computing log and each normal function once.
+		inline sensitivity greeks(double f, double s, double k)
+		{
+			double m = moneyness(f, k, s);
+			auto [N1, n1] = normal::cdf_pdf(m, s); // P^s(Z <= m), ϕ(m - s)
+			double N0 = normal::cdf(m);
+
+			return sensitivity{
+				.value = k * N0 - f * N1,
+				.delta = -N1,
+				.gamma = n1 / (f * s),
+				.vega = f * n1,
+				.theta = 0,
+				.rho = 0,
+			};
+		}
+		// g[i] = greeks(f[i], s[i], k[i])
+		inline void greeks(std::span<const double> f, std::span<const double> s, std::span<const double> k,
+			std::span<sensitivity> g)
+		{
+			ensure(s.size() == f.size() && k.size() == f.size() && g.size() == f.size());
+
+			for (size_t i = 0; i < f.size(); ++i) {
+				g[i] = greeks(f[i], s[i], k[i]);
+			}
+		}
+#ifdef _DEBUG
+		inline int greeks_test()
+		{
+			double h = 0.0001;
+			for (double k : { 50., 90., 100., 110., 200. }) {
+				double f = 100, s = 0.2;
+				sensitivity g = greeks(f, s, k);
+				assert(g.value == value(f, s, k));
+				assert(g.delta == delta(f, s, k));
+				assert(fabs(g.gamma - gamma(f, s, k)) <= 1e-15);
+				assert(fabs(g.vega - vega(f, s, k)) <= 1e-12);
+
+				auto v_f = [s, k](double f) { return value(f, s, k); };
+				auto d_f = [s, k](double f) { return delta(f, s, k); };
+				auto v_s = [f, k](double s) { return value(f, s, k); };
+				assert(fabs(g.delta - test::symmetric_difference_quotient(v_f, f, h)) < 10 * h);
+				assert(fabs(g.gamma - test::symmetric_difference_quotient(d_f, f, h)) < 10 * h);
+				assert(fabs(g.vega - test::symmetric_difference_quotient(v_s, s, h)) < 10 * h);
+			}
 
 			return 0;
 		}
@@ -108,10 +396,9 @@ namespace fre::black {
 			return put::vega(f, s, k);
 		}
 
-		inline double implied(double f, double p, double k,
-			double eps = sqrt(epsilon), size_t N = 100, double s = 0.1)
+		inline double implied(double f, double p, double k, size_t N = 2)
 		{
-			return put::implied(f, p - f + k, k, eps, N, s);
+			return put::implied(f, p - f + k, k, N);
 		}
 	}
 
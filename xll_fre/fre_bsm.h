@@ -3,8 +3,16 @@
 // Black price at expiration is F = f exp(s Z - s^2/2), Z standard normal.
 // Note S_t = F where f = S0 exp(rt) and s = σ√t.
 #pragma once
+#include <algorithm>
+#include <span>
 #include <tuple>
+#include <vector>
 #include "fre_black.h"
+#include "fre_monte_carlo.h"
+#ifdef _DEBUG
+#include <cassert>
+#include "fre_test.h"
+#endif // _DEBUG
 
 namespace fre::bsm {
 
@@ -36,8 +44,321 @@ namespace fre::bsm {
 
 			return black::put::delta(f, s, k);
 		}
+
+		// Value, delta, gamma, vega, theta, and rho from one Black evaluation.
+		// Theta is -d/dt with t the time to expiration.
+		inline black::sensitivity greeks(double r, double S0, double σ, double k, double t)
+		{
+			auto [R, f, s] = bsm_to_black(r, S0, σ, t);
+			black::sensitivity g = black::put::greeks(f, s, k);
+
+			double v = g.value / R;
+			// d/dt: df/dt = r f, ds/dt = σ/(2 sqrt(t)), d(1/R)/dt = -r/R
+			double dvdt = (g.delta * r * f + g.vega * s / (2 * t)) / R - r * v;
+
+			return black::sensitivity{
+				.value = v,
+				.delta = g.delta, // df/dS0 = R
+				.gamma = g.gamma * R,
+				.vega = g.vega * sqrt(t) / R,
+				.theta = -dvdt,
+				.rho = t * (S0 * g.delta - v), // df/dr = t f, d(1/R)/dr = -t/R
+			};
+		}
+#ifdef _DEBUG
+		inline int greeks_test()
+		{
+			double r = 0.05, S0 = 100, σ = 0.2, t = 0.5, h = 0.0001;
+			for (double k : { 50., 90., 100., 110., 200. }) {
+				black::sensitivity g = greeks(r, S0, σ, k, t);
+				assert(fabs(g.value - value(r, S0, σ, k, t)) <= 1e-12);
+				assert(g.delta == delta(r, S0, σ, k, t));
+
+				auto v_S = [=](double S) { return value(r, S, σ, k, t); };
+				auto d_S = [=](double S) { return delta(r, S, σ, k, t); };
+				auto v_σ = [=](double σ_) { return value(r, S0, σ_, k, t); };
+				auto v_t = [=](double t_) { return value(r, S0, σ, k, t_); };
+				auto v_r = [=](double r_) { return value(r_, S0, σ, k, t); };
+				assert(fabs(g.delta - test::symmetric_difference_quotient(v_S, S0, h)) < 10 * h);
+				assert(fabs(g.gamma - test::symmetric_difference_quotient(d_S, S0, h)) < 10 * h);
+				assert(fabs(g.vega - test::symmetric_difference_quotient(v_σ, σ, h)) < 10 * h);
+				assert(fabs(g.theta + test::symmetric_difference_quotient(v_t, t, h)) < 10 * h);
+				assert(fabs(g.rho - test::symmetric_difference_quotient(v_r, r, h)) < 10 * h);
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
+		// g[i] = greeks(r[i], S0[i], σ[i], k[i], t[i])
+		inline void greeks(std::span<const double> r, std::span<const double> S0, std::span<const double> σ,
+			std::span<const double> k, std::span<const double> t, std::span<black::sensitivity> g)
+		{
+			const size_t n = r.size();
+			ensure(S0.size() == n && σ.size() == n && k.size() == n && t.size() == n && g.size() == n);
+
+			for (size_t i = 0; i < n; ++i) {
+				g[i] = greeks(r[i], S0[i], σ[i], k[i], t[i]);
+			}
+		}
 	}
 
+	// Multi-step paths S_t = S0 exp(r t + σ B_t - σ^2 t/2) on a time grid.
+	namespace path {
+
+		// Buffer layout for m paths on n times. Time major stores S[i m + j] so each time is a
+		// contiguous vector of paths. Path major stores S[j n + i] so each path is contiguous.
+		enum class layout { time_major, path_major };
+
+		class model {
+			double r, S0;
+			std::vector<double> t;
+			std::vector<double> mu, vol; // (r - σ^2/2) Δt_i and σ sqrt(Δt_i)
+		public:
+			model(double r, double S0, double σ, std::span<const double> t)
+				: r(r), S0(S0), t(t.begin(), t.end()), mu(t.size()), vol(t.size())
+			{
+				ensure(t.size() > 0);
+				for (size_t i = 0; i < t.size(); ++i) {
+					double dt = t[i] - (i == 0 ? 0 : t[i - 1]);
+					ensure(dt > 0);
+					mu[i] = (r - σ * σ / 2) * dt;
+					vol[i] = σ * sqrt(dt);
+				}
+			}
+
+			// number of times
+			size_t size() const
+			{
+				return t.size();
+			}
+			double discount() const
+			{
+				return exp(-r * t.back());
+			}
+
+			// Fill S with m paths starting at path j0. Path j uses stream philox(seed, j)
+			// so values do not depend on layout, block size, or threads. x is scratch of size m.
+			void simulate(std::span<double> S, std::span<double> x, size_t m, size_t j0,
+				uint64_t seed, layout l) const
+			{
+				const size_t n = size();
+				ensure(S.size() >= n * m && x.size() >= m);
+
+				if (l == layout::path_major) {
+					for (size_t j = 0; j < m; ++j) {
+						monte_carlo::philox g(seed, j0 + j);
+						double* Sj = S.data() + j * n;
+						double xj = 0;
+						for (size_t i = 0; i < n; ++i) {
+							xj += mu[i] + vol[i] * g.normal();
+							Sj[i] = S0 * exp(xj);
+						}
+					}
+				}
+				else {
+					// draw normals path by path, then step all paths one time at a time
+					for (size_t j = 0; j < m; ++j) {
+						monte_carlo::philox g(seed, j0 + j);
+						for (size_t i = 0; i < n; ++i) {
+							S[i * m + j] = g.normal();
+						}
+					}
+					std::fill(x.begin(), x.begin() + m, 0.);
+					for (size_t i = 0; i < n; ++i) {
+						double* Si = S.data() + i * m;
+						for (size_t j = 0; j < m; ++j) {
+							x[j] += mu[i] + vol[i] * Si[j];
+							Si[j] = S0 * exp(x[j]);
+						}
+					}
+				}
+			}
+		};
+
+		// Payoffs of one path S[0], S[stride], ..., S[(n - 1) stride] at expiration.
+		namespace payoff {
+
+			inline double average(const double* S, size_t n, size_t stride)
+			{
+				double A = 0;
+				for (size_t i = 0; i < n; ++i) {
+					A += S[i * stride];
+				}
+
+				return A / n;
+			}
+			// (k - average S)^+
+			struct asian_put {
+				double k;
+				double operator()(const double* S, size_t n, size_t stride) const
+				{
+					double A = average(S, n, stride);
+
+					return A < k ? k - A : 0;
+				}
+			};
+			// (average S - k)^+
+			struct asian_call {
+				double k;
+				double operator()(const double* S, size_t n, size_t stride) const
+				{
+					double A = average(S, n, stride);
+
+					return A > k ? A - k : 0;
+				}
+			};
+			// (S_n - k)^+ if S stays below barrier b at every time
+			struct up_and_out_call {
+				double k, b;
+				double operator()(const double* S, size_t n, size_t stride) const
+				{
+					for (size_t i = 0; i < n; ++i) {
+						if (S[i * stride] >= b) {
+							return 0;
+						}
+					}
+					double Sn = S[(n - 1) * stride];
+
+					return Sn > k ? Sn - k : 0;
+				}
+			};
+			// (k - S_n)^+ if S stays above barrier b at every time
+			struct down_and_out_put {
+				double k, b;
+				double operator()(const double* S, size_t n, size_t stride) const
+				{
+					for (size_t i = 0; i < n; ++i) {
+						if (S[i * stride] <= b) {
+							return 0;
+						}
+					}
+					double Sn = S[(n - 1) * stride];
+
+					return Sn < k ? k - Sn : 0;
+				}
+			};
+			// Floating strike lookback call S_n - min S
+			struct lookback_call {
+				double operator()(const double* S, size_t n, size_t stride) const
+				{
+					double m = S[0];
+					for (size_t i = 1; i < n; ++i) {
+						m = std::min(m, S[i * stride]);
+					}
+
+					return S[(n - 1) * stride] - m;
+				}
+			};
+			// Floating strike lookback put max S - S_n
+			struct lookback_put {
+				double operator()(const double* S, size_t n, size_t stride) const
+				{
+					double M = S[0];
+					for (size_t i = 1; i < n; ++i) {
+						M = std::max(M, S[i * stride]);
+					}
+
+					return M - S[(n - 1) * stride];
+				}
+			};
+
+		} // namespace payoff
+
+		// Discounted value of payoff p from n paths simulated block paths at a time.
+		// Each thread allocates its buffers once before its path loop.
+		template<class P>
+		inline monte_carlo::statistics value(const model& md, const P& p, size_t n, uint64_t seed = 0,
+			layout l = layout::path_major, size_t block = 256)
+		{
+			const size_t N = md.size();
+			const size_t m = (n + block - 1) / block;
+			const double D = md.discount();
+			std::vector<monte_carlo::statistics> s(m);
+
+			parallel::blocks(m, [&](size_t b, size_t e) {
+				std::vector<double> S(N * block), x(block);
+				for (size_t c = b; c < e; ++c) {
+					const size_t j0 = c * block;
+					const size_t mc = std::min(block, n - j0);
+					md.simulate(S, x, mc, j0, seed, l);
+					for (size_t j = 0; j < mc; ++j) {
+						double v = l == layout::time_major ? p(S.data() + j, N, mc) : p(S.data() + j * N, N, 1);
+						s[c].add(D * v);
+					}
+				}
+			}, 1);
+
+			monte_carlo::statistics r;
+			for (const auto& si : s) {
+				r.merge(si);
+			}
+
+			return r;
+		}
+
+		// n equal steps to t
+		inline std::vector<double> grid(double t, size_t n)
+		{
+			std::vector<double> ti(n);
+			for (size_t i = 0; i < n; ++i) {
+				ti[i] = t * (i + 1) / n;
+			}
+
+			return ti;
+		}
+
+#ifdef _DEBUG
+		inline int value_test()
+		{
+			double r = 0.05, S0 = 100, σ = 0.2, k = 100, t = 1;
+			const size_t n = 20'000;
+
+			// one step is European
+			{
+				auto ti = grid(t, 1);
+				model md(r, S0, σ, ti);
+				auto v = value(md, payoff::asian_put{ k }, n);
+				assert(fabs(v.mean - put::value(r, S0, σ, k, t)) < 4 * v.error());
+			}
+			// layouts and block sizes give identical values
+			{
+				auto ti = grid(t, 12);
+				model md(r, S0, σ, ti);
+				auto a = value(md, payoff::lookback_call{}, n, 1, layout::path_major);
+				auto b = value(md, payoff::lookback_call{}, n, 1, layout::time_major, 100);
+				assert(a.n == n && b.n == n);
+				assert(fabs(a.mean - b.mean) < 1e-12);
+				assert(a.mean > 0);
+			}
+			// far barrier is vanilla, knock out is cheaper
+			{
+				auto ti = grid(t, 12);
+				model md(r, S0, σ, ti);
+				auto v = value(md, payoff::down_and_out_put{ k, 1e-10 }, n);
+				auto p = put::value(r, S0, σ, k, t);
+				assert(fabs(v.mean - p) < 4 * v.error());
+				auto v_ = value(md, payoff::down_and_out_put{ k, 90 }, n);
+				assert(v_.mean < v.mean);
+			}
+			// put call parity for the average
+			{
+				auto ti = grid(t, 4);
+				model md(r, S0, σ, ti);
+				auto c = value(md, payoff::asian_call{ k }, n, 2);
+				auto p = value(md, payoff::asian_put{ k }, n, 2);
+				double EA = 0;
+				for (double u : ti) {
+					EA += S0 * exp(r * u) / ti.size();
+				}
+				assert(fabs(c.mean - p.mean - md.discount() * (EA - k)) < 4 * (c.error() + p.error()));
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
+
+	} // namespace path
+
 } // namespace fre::bsm
 
 
@@ -1,6 +1,10 @@
 // fre_fixed_income.h - fixed income instrument valuation
 #pragma once
+#include <algorithm>
+#include <span>
 #include <type_traits>
+#include <vector>
+#include "fre_parallel.h"
 #include "fre_pwflat.h"
 
 namespace fre::fixed_income {
@@ -10,6 +14,45 @@ namespace fre::fixed_income {
 	template<class T>
 	constexpr T NaN = std::numeric_limits<T>::quiet_NaN();
 
+	// Non-owning times and cash flows (u_i, c_i), e.g., Excel arrays or mapped schedules.
+	template<class U = double, class C = double>
+	class instrument_view {
+		size_t n;
+		const U* u; // times
+		const C* c; // cash flows
+	public:
+		constexpr instrument_view(size_t n = 0, const U* u = nullptr, const C* c = nullptr)
+			: n(n), u(u), c(c)
+		{}
+		constexpr instrument_view(std::span<const U> u, std::span<const C> c)
+			: n(u.size()), u(u.data()), c(c.data())
+		{
+			ensure(u.size() == c.size());
+		}
+
+		constexpr size_t size() const
+		{
+			return n;
+		}
+		constexpr const U* time() const
+		{
+			return u;
+		}
+		constexpr const C* cash() const
+		{
+			return c;
+		}
+
+		std::pair<U, C> back() const
+		{
+			if (n != 0) {
+				return { u[n - 1], c[n - 1] };
+			}
+
+			return { NaN<U>, NaN<C> };
+		}
+	};
+
 	// Fixed times and cash flows (u_i, c_i).
 	template<class U = double, class C = double>
 	class instrument {
@@ -21,6 +64,9 @@ namespace fre::fixed_income {
 		instrument(size_t n, const U* u, const C* c)
 			: u(u, u + n), c(c, c + n)
 		{}
+		explicit instrument(const instrument_view<U, C>& i)
+			: instrument(i.size(), i.time(), i.cash())
+		{}
 		// instrument({u0, ...}, {c0, ...})
 		instrument(std::initializer_list<U> u, std::initializer_list<C> c)
 			: u(u), c(c)
@@ -29,8 +75,19 @@ namespace fre::fixed_income {
 		}
 		instrument(const instrument& i) = default;
 		instrument& operator=(const instrument& i) = default;
+		instrument(instrument&& i) = default;
+		instrument& operator=(instrument&& i) = default;
 		~instrument() = default;
 
+		operator instrument_view<U, C>() const
+		{
+			return view();
+		}
+		instrument_view<U, C> view() const
+		{
+			return instrument_view<U, C>(size(), time(), cash());
+		}
+
 		size_t size() const
 		{
 			return u.size();
@@ -44,20 +101,30 @@ namespace fre::fixed_income {
 			return c.data();
 		}
 
-		std::pair<U, C> back() const
+		// Number of cash flows that can be appended without reallocating.
+		size_t capacity() const
 		{
-			if (size() != 0) {
-				return { u.back(), c.back() };
-			}
+			return std::min(u.capacity(), c.capacity());
+		}
+		instrument& reserve(size_t n)
+		{
+			u.reserve(n);
+			c.reserve(n);
 
-			return { NaN<U>, NaN<C> };
+			return *this;
+		}
+
+		std::pair<U, C> back() const
+		{
+			return view().back();
 		}
-		instrument& push_back(U u, C c)
+		// Append cash flow c_ at time u_ after the last time.
+		instrument& push_back(U u_, C c_)
 		{
-			ensure(u > u.back());
+			ensure(size() == 0 || u_ > u.back());
 
-			u.push_back(u);
-			c.psuh_back(c);
+			u.push_back(u_);
+			c.push_back(c_);
 
 			return *this;
 		}
@@ -65,7 +132,7 @@ namespace fre::fixed_income {
 
 	// Present value is p = sum_{u_i <= u} c_i D(u_i)
 	template<class U = double, class C = double, class T = double, class F = double>
-	inline auto present_value(const instrument<U, C>& i, const pwflat::curve<T, F>& c,
+	inline auto present_value(const instrument_view<U, C>& i, const pwflat::curve<T, F>& c,
 		U u = std::numeric_limits<U>::infinity())
 	{
 		auto p = C(0)*F(0);
@@ -73,12 +140,46 @@ namespace fre::fixed_income {
 		const U* iu = i.time();
 		const C* ic = i.cash();
 
-		for (auto j = 0; j < i.size() && iu[j] <= u; ++j) {
+		for (size_t j = 0; j < i.size() && iu[j] <= u; ++j) {
 			p += ic[j] * c.discount(iu[j]);
 		}
 
 		return p;
 	}
+	template<class U = double, class C = double, class T = double, class F = double>
+	inline auto present_value(const instrument<U, C>& i, const pwflat::curve<T, F>& c,
+		U u = std::numeric_limits<U>::infinity())
+	{
+		return present_value(i.view(), c, u);
+	}
+#ifdef _DEBUG
+	inline int instrument_test()
+	{
+		{
+			instrument<> i;
+			i.reserve(3);
+			assert(i.capacity() >= 3);
+			const double* u = i.time();
+			i.push_back(1, 0.05).push_back(2, 0.05).push_back(3, 1.05);
+			assert(i.size() == 3);
+			assert(i.time() == u); // no reallocation
+			assert(i.back().first == 3 && i.back().second == 1.05);
+		}
+		{
+			double u[] = { 1, 2 };
+			double c[] = { 0.05, 1.05 };
+			instrument_view<> v(2, u, c);
+			assert(v.time() == u && v.cash() == c);
+			assert(v.back().second == 1.05);
+			instrument<> i(v);
+			assert(i.size() == 2 && i.time() != u);
+			auto c_ = pwflat::curve<>(0.03);
+			assert(present_value(v, c_) == present_value(i, c_));
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
 
 	// Duration: derivative of present value wrt parallel shift of curve past t.
 	template<class U = double, class C = double, class T = double, class F = double>
@@ -97,6 +198,44 @@ namespace fre::fixed_income {
 
 		return p;
 	}
+	// Solve for forward _f past the end of the curve at t_ with present value p.
+	// Cash flows past t_ are c_j D(t_) exp(-_f (u_j - t_)) so value and derivative
+	// are computed in one loop with D(t_) and earlier cash flows evaluated once.
+	template<class U = double, class C = double, class T = double, class F = double>
+	inline F bootstrap_forward(const instrument<U, C>& i, const pwflat::curve<T, F>& c, F p, F _f,
+		F eps = sqrt(epsilon<F>), size_t N = 100)
+	{
+		auto [t_, f_] = c.back();
+		const U* iu = i.time();
+		const C* ic = i.cash();
+
+		// present value of cash flows on the known curve
+		size_t j = 0;
+		F p_ = 0;
+		for (; j < i.size() && iu[j] <= t_; ++j) {
+			p_ += ic[j] * c.discount(iu[j]);
+		}
+		ensure(j < i.size()); // at least one cash flow past end of curve
+
+		const F D_ = c.discount(t_);
+		F pv, dpv;
+		do {
+			ensure(N--);
+
+			pv = p_ - p;
+			dpv = 0;
+			for (size_t k = j; k < i.size(); ++k) {
+				F tau = iu[k] - t_;
+				F ck = ic[k] * D_ * exp(-_f * tau);
+				pv += ck;
+				dpv -= tau * ck;
+			}
+			_f = _f - pv / dpv; // use Newton-Raphson for root of pv - p
+		} while (fabs(pv) > eps);
+
+		return _f;
+	}
+
 	// Bootstrap: extrapolate curve to reprice instrument
 	template<class U = double, class C = double, class T = double, class F = double>
 	inline F bootstrap(const instrument<U, C>& i, pwflat::curve<T, F>& c, F p = 0,
@@ -112,18 +251,30 @@ namespace fre::fixed_income {
 
 		// extrapolate by _f initial guess
 		F _f = c.size() != 0 ? f_ : 0.01;
-		
-		// present value and its derivative using extrapolated curve
-		auto pv = [&i, &c](F f) { return present_value(i, c.extrapolate(f)); };
-		auto dpv = [&i, &c, t_](F f) { return duration(i, c.extrapolate(f), t_); };
-		
-		while (fabs(pv(_f) - p) > eps) {
-			ensure(N--);
-			_f = _f - (pv(_f) - p)/dpv(_f); // use Newton-Raphson for root of pv - p
-		}
-		
+
+		_f = bootstrap_forward(i, c, p, _f, eps, N);
+		c.extrapolate(_f);
+
 		return _f;
 	}
+
+	// Extend curve to reprice instruments with present values p, sorted by maturity.
+	// Each instrument adds one knot at its last cash flow using the curve built so far.
+	template<class U = double, class C = double, class T = double, class F = double>
+	inline pwflat::curve<T, F>& bootstrap(size_t n, const instrument<U, C>* is, const F* p,
+		pwflat::curve<T, F>& c, F eps = sqrt(epsilon<F>), size_t N = 100)
+	{
+		F _f = c.size() != 0 ? c.back().second : 0.01;
+		for (size_t k = 0; k < n; ++k) {
+			auto [u_, c_] = is[k].back();
+			ensure(c.size() == 0 || u_ > c.back().first); // sorted by maturity
+
+			_f = bootstrap_forward(is[k], c, p[k], _f, eps, N);
+			c.extend(u_, _f);
+		}
+
+		return c;
+	}
 #ifdef _DEBUG
 	inline int bootstrap_test()
 	{
@@ -149,10 +300,262 @@ namespace fre::fixed_income {
 			auto _f = bootstrap(i, c, p);
 			ensure(fabs(_f - .04) < 10 * sqrt(epsilon<double>));
 		}
+		{
+			// recover forwards from par bonds priced on a known curve
+			std::vector<double> t = { 0.5, 1, 2, 3, 5, 7, 10 };
+			std::vector<double> f = { 0.02, 0.025, 0.03, 0.032, 0.035, 0.034, 0.036 };
+			pwflat::curve<> c0(t, f);
+			std::vector<instrument<>> is;
+			std::vector<double> p;
+			for (double u : t) {
+				std::vector<double> ui, ci;
+				for (double s = u; s > 0; s -= 0.5) {
+					ui.insert(ui.begin(), s);
+					ci.insert(ci.begin(), 0.015);
+				}
+				ci.back() += 1;
+				is.push_back(instrument<>(ui.size(), ui.data(), ci.data()));
+				p.push_back(present_value(is.back(), c0));
+			}
+			pwflat::curve<> c;
+			bootstrap(is.size(), is.data(), p.data(), c);
+			ensure(c.size() == t.size());
+			for (size_t k = 0; k < t.size(); ++k) {
+				ensure(c.time()[k] == t[k]);
+				ensure(fabs(c.rate()[k] - f[k]) < 1e-10);
+			}
+		}
 
 		return 0;
 	}
 #endif // _DEBUG
+	// Add dPV/df_k for each forward segment k of the curve to dpv using one reverse pass.
+	// Segment k is (t[k-1], t[k]] for k < n and the extrapolation past t[n-1] for k = n.
+	// PV = sum_j c_j D(u_j) and D(u) = exp(-sum_k f_k |(t[k-1], t[k]] ∩ (0, u]|) so
+	// dPV/df_k = -sum_j c_j D(u_j) |(t[k-1], t[k]] ∩ (0, u_j]|.
+	template<class U = double, class C = double, class T = double, class F = double>
+	inline void ladder(const instrument<U, C>& i, const pwflat::curve<T, F>& c, std::span<F> dpv)
+	{
+		const size_t n = c.size();
+		ensure(dpv.size() == n + 1);
+
+		const T* t = c.time();
+		const U* iu = i.time();
+		const C* ic = i.cash();
+
+		// partial segment of each cash flow, sweeping cash flows forward
+		std::vector<F> a(n + 1, 0); // sum of adjoints -c_j D(u_j) for cash flows ending in segment k
+		size_t k = 0;
+		for (size_t j = 0; j < i.size(); ++j) {
+			while (k < n && t[k] < iu[j]) {
+				++k;
+			}
+			F aj = -ic[j] * c.discount(iu[j]);
+			a[k] += aj;
+			dpv[k] += aj * (iu[j] - (k == 0 ? 0 : t[k - 1]));
+		}
+		// full segments below each cash flow, sweeping segments backward
+		F A = 0; // sum of adjoints of cash flows past segment k
+		for (k = n; k-- > 0; ) {
+			A += a[k + 1];
+			dpv[k] += A * (t[k] - (k == 0 ? 0 : t[k - 1]));
+		}
+	}
+	// Key rate ladder of an instrument.
+	template<class U = double, class C = double, class T = double, class F = double>
+	inline std::vector<F> ladder(const instrument<U, C>& i, const pwflat::curve<T, F>& c)
+	{
+		std::vector<F> dpv(c.size() + 1, 0);
+		ladder(i, c, std::span<F>(dpv));
+
+		return dpv;
+	}
+	// Key rate ladder of a portfolio.
+	template<class U = double, class C = double, class T = double, class F = double>
+	inline std::vector<F> ladder(size_t n, const instrument<U, C>* is, const pwflat::curve<T, F>& c)
+	{
+		std::vector<F> dpv(c.size() + 1, 0);
+		for (size_t j = 0; j < n; ++j) {
+			ladder(is[j], c, std::span<F>(dpv));
+		}
+
+		return dpv;
+	}
+#ifdef _DEBUG
+	inline int ladder_test()
+	{
+		std::vector<double> t = { 0.5, 1, 2, 3, 5 };
+		std::vector<double> f = { 0.02, 0.025, 0.03, 0.032, 0.035 };
+		pwflat::curve<> c(t, f, 0.04);
+		std::vector<instrument<>> is = {
+			instrument({ 0.25, 1., 2., 2.5, 4., 7. }, { 0.02, 0.02, 0.02, 0.02, 0.02, 1.02 }),
+			instrument({ 1. }, { 1. }),
+			instrument({ 3., 6. }, { 0.5, 0.5 }),
+		};
+
+		auto dpv = ladder(is.size(), is.data(), c);
+		assert(dpv.size() == t.size() + 1);
+
+		// bump and reprice each segment
+		double h = 1e-6;
+		for (size_t k = 0; k <= t.size(); ++k) {
+			auto bump = [&](double dh) {
+				std::vector<double> f_ = f;
+				double _f = 0.04;
+				(k < t.size() ? f_[k] : _f) += dh;
+				pwflat::curve<> c_(t, f_, _f);
+				double p = 0;
+				for (const auto& i : is) {
+					p += present_value(i, c_);
+				}
+				return p;
+			};
+			double dp = (bump(h) - bump(-h)) / (2 * h);
+			assert(fabs(dpv[k] - dp) < 1e-8);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+	// Instruments with cash flows stored contiguously. Cash flow times are indexed
+	// into unique sorted times so a curve is evaluated once per distinct time.
+	template<class U = double, class C = double>
+	class portfolio {
+		std::vector<size_t> off; // cash flows of instrument k are [off[k], off[k + 1])
+		std::vector<U> u; // cash flow times
+		std::vector<C> c; // cash flows
+		std::vector<U> t; // unique sorted cash flow times
+		std::vector<size_t> j; // u[m] = t[j[m]]
+	public:
+		portfolio()
+			: off{ 0 }
+		{}
+		portfolio(size_t n, const instrument<U, C>* is)
+			: portfolio()
+		{
+			size_t m = 0;
+			for (size_t k = 0; k < n; ++k) {
+				m += is[k].size();
+			}
+			off.reserve(n + 1);
+			u.reserve(m);
+			c.reserve(m);
+			for (size_t k = 0; k < n; ++k) {
+				push_back(is[k]);
+			}
+			index();
+		}
+		portfolio(const portfolio&) = default;
+		portfolio& operator=(const portfolio&) = default;
+		~portfolio() = default;
+
+		// number of instruments
+		size_t size() const
+		{
+			return off.size() - 1;
+		}
+		// unique sorted cash flow times
+		std::span<const U> times() const
+		{
+			return t;
+		}
+		bool indexed() const
+		{
+			return j.size() == u.size();
+		}
+
+		// Append instrument. Call index() before valuing.
+		portfolio& push_back(const instrument_view<U, C>& i)
+		{
+			u.insert(u.end(), i.time(), i.time() + i.size());
+			c.insert(c.end(), i.cash(), i.cash() + i.size());
+			off.push_back(u.size());
+			j.clear();
+
+			return *this;
+		}
+		// Sort and deduplicate cash flow times.
+		portfolio& index()
+		{
+			t = u;
+			std::sort(t.begin(), t.end());
+			t.erase(std::unique(t.begin(), t.end()), t.end());
+
+			j.resize(u.size());
+			for (size_t m = 0; m < u.size(); ++m) {
+				j[m] = std::lower_bound(t.begin(), t.end(), u[m]) - t.begin();
+			}
+
+			return *this;
+		}
+
+		// Set pv[k] to the present value of instrument k and return the total.
+		// Discounts at unique times come from one bulk curve evaluation.
+		template<class T = double, class F = double>
+		F present_value(const pwflat::curve<T, F>& curve, std::span<F> pv) const
+		{
+			ensure(indexed());
+			ensure(pv.size() == size());
+
+			std::vector<F> D(t.size());
+			curve.discounts(std::span<const T>(t), std::span<F>(D));
+
+			parallel::blocks(size(), [&](size_t b, size_t e) {
+				for (size_t k = b; k < e; ++k) {
+					F p = 0;
+					for (size_t m = off[k]; m < off[k + 1]; ++m) {
+						p += c[m] * D[j[m]];
+					}
+					pv[k] = p;
+				}
+			}, 256);
+
+			F p = 0;
+			for (size_t k = 0; k < size(); ++k) {
+				p += pv[k];
+			}
+
+			return p;
+		}
+	};
+#ifdef _DEBUG
+	inline int portfolio_test()
+	{
+		pwflat::curve<> c({ 0.5, 1., 2., 3., 5. }, { 0.02, 0.025, 0.03, 0.032, 0.035 }, 0.04);
+		std::vector<instrument<>> is;
+		for (size_t k = 1; k <= 1000; ++k) {
+			std::vector<double> u, cf;
+			for (double s = 0.5 * (k % 20 + 1); s > 0; s -= 0.5) {
+				u.insert(u.begin(), s);
+				cf.insert(cf.begin(), 0.001 * (k % 50));
+			}
+			cf.back() += 1;
+			is.push_back(instrument<>(u.size(), u.data(), cf.data()));
+		}
+
+		portfolio<> p(is.size(), is.data());
+		assert(p.size() == is.size());
+		assert(p.times().size() == 20);
+
+		std::vector<double> pv(p.size());
+		double total = p.present_value(c, std::span<double>(pv));
+		double total_ = 0;
+		for (size_t k = 0; k < is.size(); ++k) {
+			double pv_ = present_value(is[k], c);
+			assert(fabs(pv[k] - pv_) <= 1e-14);
+			total_ += pv_;
+		}
+		assert(fabs(total - total_) <= 1e-10);
+
+		p.push_back(instrument({ 0.25 }, { 1. }));
+		assert(!p.indexed());
+		assert(p.index().times().size() == 21);
+
+		return 0;
+	}
+#endif // _DEBUG
+
 	// Yield: constant forward rate y with p = present_value(i, curve(y))
 	// Convexity
 
@@ -0,0 +1,193 @@
+// fre_fourier.h - Fourier-cosine (COS) pricing from the characteristic function.
+// F. Fang and C. W. Oosterlee, A novel pricing method for European options based on
+// Fourier-cosine series expansions, SIAM J. Sci. Comput. 31 (2008).
+// F = f exp(Y) with Y = s X - kappa(s) where X has E[X] = 0 and Var(X) = 1.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <concepts>
+#include <span>
+#include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#include "fre_black.h"
+#endif // _DEBUG
+#include "fre_variate.h"
+
+namespace fre::variate {
+
+	// Variates with a cumulant generating function on the complex plane.
+	template<class V>
+	concept characteristic = requires(const V & v, std::complex<double> s) {
+		{ v.cgf(s) } -> std::convertible_to<std::complex<double>>;
+	};
+
+	// Standardized variance gamma. Z = θ G + sqrt(G) W with G gamma of mean 1 and variance ν,
+	// X = (Z - θ)/c with c^2 = 1 + ν θ^2. Skew from θ and excess kurtosis from ν.
+	// E[e^{sX}] is finite only for real s with 1 - θ ν s/c - ν s^2/(2 c^2) > 0.
+	struct variance_gamma {
+		double θ, ν;
+
+		// log E[e^{sX}] = -log(1 - θ ν s/c - ν s^2/(2 c^2))/ν - θ s/c
+		template<class S>
+		S cgf(S s) const
+		{
+			double c = std::sqrt(1 + ν * θ * θ);
+			S u = s / c;
+
+			return -std::log(1. - θ * ν * u - ν * u * u / 2.) / ν - θ * u;
+		}
+	};
+
+} // namespace fre::variate
+
+namespace fre::fourier {
+
+	// Cosine coefficients of the density of Y on [a, b] reused for every strike.
+	// A_j = 2/(b - a) Re(phi(u_j) e^{-i u_j a}), u_j = j pi/(b - a), phi(u) = E[e^{i u Y}].
+	class density {
+		double a, b;
+		std::vector<double> A;
+
+		// kappa(s) = log E[exp(s X)] must be finite. Outside its domain the complex log of a
+		// negative number has imaginary part pi instead of failing.
+		template<variate::characteristic V>
+		static double kappa(double s, const V& X)
+		{
+			const std::complex<double> k = X.cgf(std::complex<double>(s, 0));
+			ensure(std::isfinite(k.real()) && k.imag() == 0);
+
+			return k.real();
+		}
+		template<variate::characteristic V>
+		density(double s, const V& X, double kappa, size_t N, double L)
+			: density([&X, s, kappa](double u) {
+					using cd = std::complex<double>;
+					return std::exp(X.cgf(cd(0, u * s)) - cd(0, u * kappa));
+				}, -kappa, s * s, N, L)
+		{ }
+	public:
+		// Coefficients from phi(u) = E[e^{i u Y}] truncated to c1 -/+ L sqrt(c2) where c1 = E[Y] and c2 = Var(Y).
+		template<class Phi>
+			requires std::invocable<const Phi&, double>
+		density(const Phi& phi, double c1, double c2, size_t N = 256, double L = 12)
+			: a(c1 - L * std::sqrt(c2)), b(c1 + L * std::sqrt(c2)), A(N)
+		{
+			using cd = std::complex<double>;
+			for (size_t j = 0; j < N; ++j) {
+				double u = j * M_PI / (b - a);
+				A[j] = 2 / (b - a) * std::real(phi(u) * std::exp(cd(0, -u * a)));
+			}
+			A[0] /= 2; // first term has weight 1/2
+		}
+		// Y = s X - kappa(s) has E[Y] = -kappa and Var(Y) = s^2.
+		template<variate::characteristic V>
+		density(double s, const V& X, size_t N = 256, double L = 12)
+			: density(s, X, kappa(s, X), N, L)
+		{ }
+
+		// Put value E[(k - f e^Y)^+] and delta -E[e^Y 1(f e^Y <= k)] for each strike.
+		// psi_j = int_a^d cos(u_j (y - a)) dy and chi_j = int_a^d e^y cos(u_j (y - a)) dy with d = log(k/f)
+		// need cos and sin of u_j (d - a). They come from rotating by u_1 (d - a) with strikes in the
+		// inner loop so each term is a unit stride pass over the chain.
+		void put(double f, std::span<const double> k, std::span<double> v, std::span<double> dv) const
+		{
+			const size_t n = k.size();
+			ensure(v.size() == n && dv.size() == n);
+
+			const double w = M_PI / (b - a), ea = std::exp(a);
+			std::vector<double> ed(n), c1(n), s1(n), cj(n, 1.), sj(n, 0.);
+			// j = 0: psi = d - a, chi = e^d - e^a
+			for (size_t i = 0; i < n; ++i) {
+				double d = std::clamp(std::log(k[i] / f), a, b);
+				ed[i] = std::exp(d);
+				c1[i] = std::cos(w * (d - a));
+				s1[i] = std::sin(w * (d - a));
+				v[i] = A[0] * (d - a);
+				dv[i] = A[0] * (ed[i] - ea);
+			}
+			for (size_t j = 1; j < A.size(); ++j) {
+				const double u = j * w;
+				const double p = A[j] / u, q = A[j] / (1 + u * u);
+				for (size_t i = 0; i < n; ++i) {
+					double c = cj[i] * c1[i] - sj[i] * s1[i];
+					sj[i] = sj[i] * c1[i] + cj[i] * s1[i];
+					cj[i] = c;
+					v[i] += p * sj[i];
+					dv[i] += q * ((cj[i] + u * sj[i]) * ed[i] - ea);
+				}
+			}
+			for (size_t i = 0; i < n; ++i) {
+				v[i] = k[i] * v[i] - f * dv[i];
+				dv[i] = -dv[i];
+			}
+		}
+	};
+
+	namespace put {
+
+		// Values and deltas of puts on F = f exp(s X - kappa(s)) for a strike chain in O(N K).
+		template<variate::characteristic V = variate::standard_normal>
+		inline void chain(double f, double s, std::span<const double> k,
+			std::span<double> v, std::span<double> d, const V& X = V{}, size_t N = 256)
+		{
+			density(s, X, N).put(f, k, v, d);
+		}
+
+#ifdef _DEBUG
+		inline int chain_test()
+		{
+			std::vector<double> k;
+			for (double k_ = 50; k_ <= 200; k_ += 5) {
+				k.push_back(k_);
+			}
+			std::vector<double> v(k.size()), d(k.size());
+
+			for (double s : { 0.05, 0.2, 0.5 }) {
+				chain(100, s, k, v, d);
+				for (size_t i = 0; i < k.size(); ++i) {
+					assert(fabs(v[i] - black::put::value(100, s, k[i])) < 1e-10);
+					assert(fabs(d[i] - black::put::delta(100, s, k[i])) < 1e-10);
+				}
+			}
+
+			// variance gamma tends to normal as ν -> 0
+			chain(100, 0.2, k, v, d, variate::variance_gamma{ 0.1, 1e-8 });
+			for (size_t i = 0; i < k.size(); ++i) {
+				assert(fabs(v[i] - black::put::value(100, 0.2, k[i])) < 1e-6);
+			}
+			// fat tails are worth more away from the money, prices stay convex in k
+			const variate::variance_gamma X{ -0.2, 0.5 };
+			chain(100, 0.2, k, v, d, X);
+			assert(v.front() > black::put::value(100, 0.2, k.front()));
+			for (size_t i = 1; i + 1 < k.size(); ++i) {
+				assert(v[i - 1] - 2 * v[i] + v[i + 1] > -1e-10);
+				assert(d[i] <= d[i - 1] + 1e-10);
+			}
+			// s = 1.5 is outside the domain of the variance gamma cgf when ν = 1
+			{
+				bool thrown = false;
+				try {
+					chain(100, 1.5, k, v, d, variate::variance_gamma{ 0, 1 });
+				}
+				catch (const std::exception&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+			// converged in N
+			std::vector<double> v_(k.size()), d_(k.size());
+			chain(100, 0.2, k, v_, d_, X, 1024);
+			for (size_t i = 0; i < k.size(); ++i) {
+				assert(fabs(v[i] - v_[i]) < 1e-6);
+				assert(fabs(d[i] - d_[i]) < 1e-6);
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
+
+	} // namespace put
+
+} // namespace fre::fourier
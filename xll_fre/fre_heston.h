@@ -0,0 +1,380 @@
+// fre_heston.h - Heston stochastic volatility model.
+// dF/F = sqrt(v) dW, dv = κ(θ - v) dt + ξ sqrt(v) dZ, dW dZ = ρ dt.
+// Prices are undiscounted, as in fre_black.h.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <numeric>
+#include <span>
+#include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#endif // _DEBUG
+#include "fre_black.h"
+#include "fre_fourier.h"
+#include "fre_parallel.h"
+
+namespace fre::heston {
+
+	struct model {
+		double v0, θ, κ, ξ, ρ;
+
+		// log E[exp(i u log(F_t/f))] = C + D v0 in the "little trap" form of Albrecher et al.
+		// β = κ - i ρ ξ u, d = sqrt(β^2 + ξ^2 (i u + u^2)), g = (β - d)/(β + d) stays inside the unit disk
+		// so log(1 - g e^{-dt}) never crosses the branch cut. β - d = -ξ^2 (i u + u^2)/(β + d) and
+		// log((1 - g e)/(1 - g)) = log(1 + ξ^2 z) with a series for small ξ^2 z, so ξ = 0 is exact.
+		std::complex<double> cgf(double u, double t) const
+		{
+			using cd = std::complex<double>;
+			const cd β = cd(κ, -ρ * ξ * u);
+			const cd iu2 = cd(u * u, u);
+			const cd d = std::sqrt(β * β + ξ * ξ * iu2);
+			const cd q = -iu2 / (β + d); // (β - d)/ξ^2
+			const cd g = ξ * ξ * q / (β + d);
+			const cd e = std::exp(-d * t);
+			const cd D = q * (1. - e) / (1. - g * e);
+			const cd z = q * (1. - e) / ((β + d) * (1. - g));
+			const cd x = ξ * ξ * z;
+			// l = log(1 + ξ^2 z)/ξ^2
+			const cd l = std::abs(x) < 1e-3 ? z * (1. - x * (1. / 2 - x * (1. / 3 - x / 4.))) : std::log(1. + x) / (ξ * ξ);
+			const cd C = κ * θ * (q * t - 2. * l);
+
+			return C + D * v0;
+		}
+
+		// E[int_0^t v_s ds]
+		double variance(double t) const
+		{
+			return θ * t + (v0 - θ) * (κ * t > 1e-8 ? -std::expm1(-κ * t) / κ : t);
+		}
+
+		// Cosine coefficients of log(F_t/f) shared by every strike expiring at t.
+		// E[log(F_t/f)] = -variance/2. Cumulants c2 and c4 come from Re cgf(h) = -c2 h^2/2 + c4 h^4/24 + ...
+		// at h and 2h, and truncation is c1 -/+ L sqrt(c2 + sqrt(c4)) as in Fang and Oosterlee.
+		fourier::density density(double t, size_t N = 256, double L = 10) const
+		{
+			const double w = variance(t);
+			const double h = 0.1 / std::sqrt(w);
+			const double A = std::real(cgf(h, t)), B = std::real(cgf(2 * h, t));
+			const double c2 = -(16 * A - B) / (6 * h * h);
+			const double c4 = 2 * (B - 4 * A) / (h * h * h * h);
+
+			return fourier::density([this, t](double u) { return std::exp(cgf(u, t)); },
+				-w / 2, c2 + std::sqrt(std::fabs(c4)), N, L);
+		}
+	};
+
+	namespace put {
+
+		// Values and forward deltas of puts expiring at t for a strike chain.
+		inline void chain(double f, double t, std::span<const double> k, std::span<double> v, std::span<double> d,
+			const model& m, size_t N = 256)
+		{
+			m.density(t, N).put(f, k, v, d);
+		}
+
+#ifdef _DEBUG
+		inline int chain_test()
+		{
+			// Fang and Oosterlee (2008) Table 4: at-the-money call 5.785155450, equal to the put when r = 0
+			{
+				const model m{ 0.0175, 0.0398, 1.5768, 0.5751, -0.5711 };
+				double k = 100, v, d;
+				chain(100, 1, { &k, 1 }, { &v, 1 }, { &d, 1 }, m);
+				assert(fabs(v - 5.785155450) < 1e-6);
+			}
+			// zero vol of vol is Black with the expected total variance
+			{
+				const model m{ 0.04, 0.09, 2, 0, -0.7 };
+				const double t = 0.5, s = std::sqrt(m.variance(t));
+				std::vector<double> k = { 60, 80, 95, 100, 105, 120, 150 };
+				std::vector<double> v(k.size()), d(k.size());
+				chain(100, t, k, v, d, m);
+				for (size_t i = 0; i < k.size(); ++i) {
+					assert(fabs(v[i] - black::put::value(100, s, k[i])) < 1e-10);
+					assert(fabs(d[i] - black::put::delta(100, s, k[i])) < 1e-10);
+				}
+			}
+			// and the limit of vanishing uncorrelated vol of vol
+			{
+				const model m{ 0.04, 0.09, 2, 1e-4, 0 };
+				const double t = 0.5, s = std::sqrt(m.variance(t));
+				std::vector<double> k = { 60, 80, 95, 100, 105, 120, 150 };
+				std::vector<double> v(k.size()), d(k.size());
+				chain(100, t, k, v, d, m);
+				for (size_t i = 0; i < k.size(); ++i) {
+					assert(fabs(v[i] - black::put::value(100, s, k[i])) < 1e-7);
+					assert(fabs(d[i] - black::put::delta(100, s, k[i])) < 1e-7);
+				}
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
+
+	} // namespace put
+
+	// Solve A x = b in place for symmetric positive definite n x n row major A.
+	inline bool cholesky(std::span<double> A, std::span<double> b)
+	{
+		const size_t n = b.size();
+		for (size_t j = 0; j < n; ++j) {
+			double s = A[j * n + j];
+			for (size_t k = 0; k < j; ++k) {
+				s -= A[j * n + k] * A[j * n + k];
+			}
+			if (!(s > 0)) {
+				return false;
+			}
+			A[j * n + j] = std::sqrt(s);
+			for (size_t i = j + 1; i < n; ++i) {
+				double t = A[i * n + j];
+				for (size_t k = 0; k < j; ++k) {
+					t -= A[i * n + k] * A[j * n + k];
+				}
+				A[i * n + j] = t / A[j * n + j];
+			}
+		}
+		for (size_t i = 0; i < n; ++i) { // L y = b
+			for (size_t k = 0; k < i; ++k) {
+				b[i] -= A[i * n + k] * b[k];
+			}
+			b[i] /= A[i * n + i];
+		}
+		for (size_t i = n; i-- > 0;) { // L' x = y
+			for (size_t k = i + 1; k < n; ++k) {
+				b[i] -= A[k * n + i] * b[k];
+			}
+			b[i] /= A[i * n + i];
+		}
+
+		return true;
+	}
+
+	// Quotes of Black implied vol σ_i at expiry t_i and strike k_i grouped by expiry
+	// so each expiry prices its strikes from one cosine grid.
+	class surface {
+		double f;
+		std::vector<double> t;      // unique expiries
+		std::vector<size_t> j;      // quotes of expiry i are [j[i], j[i + 1])
+		std::vector<size_t> index;  // quote position in the caller's order
+		std::vector<double> k, p, vega;
+		size_t N;
+	public:
+		surface(double f, std::span<const double> t_, std::span<const double> k_, std::span<const double> σ,
+			size_t N = 128)
+			: f(f), index(t_.size()), k(t_.size()), p(t_.size()), vega(t_.size()), N(N)
+		{
+			ensure(k_.size() == t_.size() && σ.size() == t_.size());
+
+			std::iota(index.begin(), index.end(), size_t(0));
+			std::stable_sort(index.begin(), index.end(), [&t_](size_t a, size_t b) { return t_[a] < t_[b]; });
+			for (size_t i = 0; i < index.size(); ++i) {
+				const size_t q = index[i];
+				ensure(t_[q] > 0 && σ[q] > 0);
+				if (t.empty() || t.back() != t_[q]) {
+					t.push_back(t_[q]);
+					j.push_back(i);
+				}
+				const double s = σ[q] * std::sqrt(t_[q]);
+				k[i] = k_[q];
+				p[i] = black::put::value(f, s, k[i]);
+				// dp/dσ floored so far wings do not amplify pricing noise
+				vega[i] = std::max(black::put::vega(f, s, k[i]) * std::sqrt(t_[q]), 1e-3 * f * std::sqrt(t_[q]));
+			}
+			j.push_back(index.size());
+		}
+
+		size_t size() const
+		{
+			return index.size();
+		}
+
+		// Model put values in the caller's order.
+		void value(const model& m, std::span<double> v) const
+		{
+			ensure(v.size() == size());
+
+			std::vector<double> v_(size()), d_(size());
+			for (size_t i = 0; i + 1 < j.size(); ++i) {
+				const size_t b = j[i], e = j[i + 1];
+				auto s = [b, e](std::vector<double>& x) { return std::span<double>(x.data() + b, e - b); };
+				m.density(t[i], N).put(f, std::span<const double>(k.data() + b, e - b), s(v_), s(d_));
+			}
+			for (size_t i = 0; i < size(); ++i) {
+				v[index[i]] = v_[i];
+			}
+		}
+
+		// r_i = (model - market)/vega, approximately the implied vol error, in sorted order.
+		void residual(const model& m, std::span<double> r) const
+		{
+			ensure(r.size() == size());
+
+			std::vector<double> d(size());
+			for (size_t i = 0; i + 1 < j.size(); ++i) {
+				const size_t b = j[i], e = j[i + 1];
+				m.density(t[i], N).put(f, std::span<const double>(k.data() + b, e - b), r.subspan(b, e - b),
+					std::span<double>(d.data() + b, e - b));
+			}
+			for (size_t i = 0; i < size(); ++i) {
+				r[i] = (r[i] - p[i]) / vega[i];
+			}
+		}
+	};
+
+	// Unconstrained coordinates (log v0, log θ, log κ, log ξ, atanh ρ).
+	inline std::array<double, 5> to(const model& m)
+	{
+		return { std::log(m.v0), std::log(m.θ), std::log(m.κ), std::log(m.ξ), std::atanh(m.ρ) };
+	}
+	inline model from(const std::array<double, 5>& x)
+	{
+		return { std::exp(x[0]), std::exp(x[1]), std::exp(x[2]), std::exp(x[3]), std::tanh(x[4]) };
+	}
+
+	// Levenberg-Marquardt fit of the five parameters starting from m with v0, θ, κ, ξ > 0 and |ρ| < 1.
+	// The finite difference Jacobian columns are evaluated on separate threads.
+	inline model calibrate(const surface& s, model m, size_t iterations = 100, double tolerance = 1e-10)
+	{
+		ensure(m.v0 > 0 && m.θ > 0 && m.κ > 0 && m.ξ > 0 && std::fabs(m.ρ) < 1);
+
+		const size_t n = s.size();
+		std::array<double, 5> x = to(m);
+		std::vector<double> r(n), r_(n), J(5 * n);
+		auto norm2 = [](const std::vector<double>& y) { return std::inner_product(y.begin(), y.end(), y.begin(), 0.); };
+
+		s.residual(from(x), r);
+		double c = norm2(r);
+		double λ = 1e-3;
+		for (size_t it = 0; it < iterations; ++it) {
+			parallel::blocks(5, [&](size_t b, size_t e) {
+				for (size_t p = b; p < e; ++p) {
+					std::array<double, 5> y = x;
+					const double h = 1e-6 * std::max(1., std::fabs(x[p]));
+					y[p] += h;
+					std::span<double> Jp(J.data() + p * n, n);
+					s.residual(from(y), Jp);
+					for (size_t i = 0; i < n; ++i) {
+						Jp[i] = (Jp[i] - r[i]) / h;
+					}
+				}
+			}, 1);
+
+			// normal equations J'J and gradient J'r
+			std::array<double, 25> A;
+			std::array<double, 5> g;
+			for (size_t p = 0; p < 5; ++p) {
+				const double* Jp = J.data() + p * n;
+				for (size_t q = 0; q <= p; ++q) {
+					A[p * 5 + q] = A[q * 5 + p] = std::inner_product(Jp, Jp + n, J.data() + q * n, 0.);
+				}
+				g[p] = std::inner_product(Jp, Jp + n, r.data(), 0.);
+			}
+			if (std::ranges::all_of(g, [tolerance](double gi) { return std::fabs(gi) < tolerance; })) {
+				break;
+			}
+
+			// raise λ until the damped step lowers the sum of squares
+			double c_ = c;
+			for (; λ < 1e10; λ *= 10) {
+				std::array<double, 25> B = A;
+				std::array<double, 5> y = x, δ;
+				for (size_t p = 0; p < 5; ++p) {
+					B[p * 5 + p] += λ * std::max(A[p * 5 + p], 1e-12);
+					δ[p] = -g[p];
+				}
+				if (cholesky(B, δ)) {
+					for (size_t p = 0; p < 5; ++p) {
+						y[p] += δ[p];
+					}
+					s.residual(from(y), r_);
+					c_ = norm2(r_);
+					if (std::isfinite(c_) && c_ < c) {
+						x = y;
+						std::swap(r, r_);
+						λ = std::max(λ / 10, 1e-12);
+
+						break;
+					}
+				}
+			}
+			if (!(c_ < c) || c - c_ < tolerance * tolerance * (1 + c)) {
+				break;
+			}
+			c = c_;
+		}
+
+		return from(x);
+	}
+
+	// Fit to Black implied vols σ_i at expiry t_i and strike k_i on forward f.
+	inline model calibrate(double f, std::span<const double> t, std::span<const double> k, std::span<const double> σ,
+		const model& m, size_t N = 128)
+	{
+		return calibrate(surface(f, t, k, σ, N), m);
+	}
+
+	// Model Black implied vols σ_i at expiry t_i and strike k_i on forward f.
+	inline void implied(double f, std::span<const double> t, std::span<const double> k, const model& m,
+		std::span<double> σ, size_t N = 256)
+	{
+		ensure(σ.size() == t.size());
+
+		std::vector<double> one(t.size(), 0.1);
+		surface(f, t, k, one, N).value(m, σ);
+		for (size_t i = 0; i < t.size(); ++i) {
+			σ[i] = black::put::implied(f, σ[i], k[i]) / std::sqrt(t[i]);
+		}
+	}
+
+#ifdef _DEBUG
+	inline int calibrate_test()
+	{
+		const double f = 100;
+		const model m{ 0.04, 0.06, 1.5, 0.6, -0.6 };
+		std::vector<double> t, k;
+		for (double t_ : { 0.1, 0.25, 0.5, 0.75, 1., 1.5, 2., 3. }) {
+			for (size_t i = 0; i < 25; ++i) {
+				t.push_back(t_);
+				k.push_back(f * std::exp(std::sqrt(t_) * 0.25 * (i - 12.) / 6));
+			}
+		}
+		std::vector<double> σ(t.size());
+		implied(f, t, k, m, σ);
+		for (double s : σ) {
+			assert(s > 0.1 && s < 0.4);
+		}
+
+		// starting guesses must be inside the parameter domain
+		for (const model& m0 : { model{ 0.02, 0.02, 1, 0.3, 1 }, model{ 0.02, 0.02, 1, 0, 0 }, model{ 0, 0.02, 1, 0.3, 0 } }) {
+			bool thrown = false;
+			try {
+				calibrate(f, t, k, σ, m0);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		const model m_ = calibrate(f, t, k, σ, model{ 0.02, 0.02, 1, 0.3, 0 });
+		assert(fabs(m_.v0 - m.v0) < 1e-4);
+		assert(fabs(m_.θ - m.θ) < 1e-4);
+		assert(fabs(m_.κ - m.κ) < 1e-2);
+		assert(fabs(m_.ξ - m.ξ) < 1e-3);
+		assert(fabs(m_.ρ - m.ρ) < 1e-3);
+
+		std::vector<double> σ_(t.size());
+		implied(f, t, k, m_, σ_);
+		for (size_t i = 0; i < σ.size(); ++i) {
+			assert(fabs(σ_[i] - σ[i]) < 1e-5);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fre::heston
@@ -1,7 +1,16 @@
 ﻿// fre_ho_lee.h - Ho-Lee interest rate model for constant futures and volatility.
 #pragma once
+#include <algorithm>
 #include <cmath>
 #include <random>
+#include <span>
+#include <vector>
+#include "../xll/xll/ensure.h"
+#ifdef _DEBUG
+#include <cassert>
+#include "fre_normal.h"
+#endif // _DEBUG
+#include "fre_monte_carlo.h"
 
 namespace fre::ho_lee {
 
@@ -43,4 +52,193 @@ namespace fre::ho_lee {
 		return std::normal_distribution(mu, std::sqrt(var));
 	}
 
+	// Simulation of f_t(u) = φ - σ^2 (u - t)^2/2 + σ B_t, short rate r_t = φ + σ B_t.
+	// Paths are simulated in blocks of m paths on dates t_0 < ... < t_{n-1}.
+	// Block buffers are time major, B[i m + j] = B_{t_i} and I[i m + j] = int_0^{t_i} B_s ds on path j,
+	// so per date loops over paths are unit stride.
+	class model {
+		double φ, σ;
+	public:
+		model(double φ, double σ)
+			: φ(φ), σ(σ)
+		{ }
+
+		// Fill B and I for m paths starting at path j0 using stream philox(seed, j).
+		// Increments of (B, int B) over [t, t + h] are exact:
+		// ΔB = sqrt(h) Z_1 and int_t^{t+h} B = B_t h + h ΔB/2 + sqrt(h^3/12) Z_2.
+		static void simulate(std::span<const double> t, std::span<double> B, std::span<double> I,
+			size_t m, size_t j0, uint64_t seed)
+		{
+			const size_t n = t.size();
+			ensure(B.size() >= n * m && I.size() >= n * m);
+
+			for (size_t j = 0; j < m; ++j) {
+				monte_carlo::philox g(seed, j0 + j);
+				for (size_t i = 0; i < n; ++i) {
+					B[i * m + j] = g.normal();
+					I[i * m + j] = g.normal();
+				}
+			}
+			for (size_t i = 0; i < n; ++i) {
+				const double h = t[i] - (i == 0 ? 0 : t[i - 1]);
+				const double a = sqrt(h), b = h * sqrt(h) / 2, c = sqrt(h * h * h / 12);
+				double* Bi = B.data() + i * m;
+				double* Ii = I.data() + i * m;
+				const double* B_ = i == 0 ? nullptr : Bi - m;
+				const double* I_ = i == 0 ? nullptr : Ii - m;
+				for (size_t j = 0; j < m; ++j) {
+					double B0 = B_ ? B_[j] : 0;
+					double I0 = I_ ? I_[j] : 0;
+					double z1 = Bi[j], z2 = Ii[j];
+					Bi[j] = B0 + a * z1;
+					Ii[j] = I0 + B0 * h + b * z1 + c * z2;
+				}
+			}
+		}
+
+		// r[j] = φ + σ B_t
+		void rate(std::span<const double> B, std::span<double> r) const
+		{
+			for (size_t j = 0; j < r.size(); ++j) {
+				r[j] = φ + σ * B[j];
+			}
+		}
+		// D[j] = D_t = exp(-int_0^t r_s ds) = exp(-φ t - σ int_0^t B_s ds)
+		void discount(double t, std::span<const double> I, std::span<double> D) const
+		{
+			for (size_t j = 0; j < D.size(); ++j) {
+				D[j] = exp(-φ * t - σ * I[j]);
+			}
+		}
+		// D[j] = D_t(u) = exp(-φ (u - t) + σ^2 (u - t)^3/6 - σ (u - t) B_t)
+		void discount(double t, double u, std::span<const double> B, std::span<double> D) const
+		{
+			const double tau = u - t;
+			const double a = -φ * tau + σ * σ * tau * tau * tau / 6;
+			const double b = -σ * tau;
+			for (size_t j = 0; j < D.size(); ++j) {
+				D[j] = exp(a + b * B[j]);
+			}
+		}
+	};
+
+	// Call f(c, m, B, I) for each block c of m paths with time major buffers B and I.
+	// Blocks run on all cores and each thread allocates its buffers once.
+	// Returns the number of blocks so callers can size per block results.
+	template<class F>
+	inline size_t simulate(std::span<const double> t, size_t n, const F& f, uint64_t seed = 0, size_t block = 1024)
+	{
+		const size_t N = t.size();
+		const size_t nb = (n + block - 1) / block;
+
+		parallel::blocks(nb, [&](size_t b, size_t e) {
+			std::vector<double> B(N * block), I(N * block);
+			for (size_t c = b; c < e; ++c) {
+				const size_t j0 = c * block;
+				const size_t m = std::min(block, n - j0);
+				model::simulate(t, B, I, m, j0, seed);
+				f(c, m, std::span<const double>(B.data(), N * m), std::span<const double>(I.data(), N * m));
+			}
+		}, 1);
+
+		return nb;
+	}
+
+	// Cap paying δ_i (L_i - k)^+ at t_{i+1} on the simple rate L_i over [t_i, t_{i+1}].
+	// Caplet i is worth E[D_{t_i} (1 - (1 + δ_i k) D_{t_i}(t_{i+1}))^+].
+	inline monte_carlo::statistics cap(double φ, double σ, std::span<const double> t, double k,
+		size_t n, uint64_t seed = 0, size_t block = 1024)
+	{
+		ensure(t.size() >= 2);
+		const model md(φ, σ);
+		const size_t N = t.size();
+		std::vector<monte_carlo::statistics> s((n + block - 1) / block);
+
+		simulate(t, n, [&](size_t c, size_t m, std::span<const double> B, std::span<const double> I) {
+			thread_local std::vector<double> v, D, P;
+			v.assign(m, 0.);
+			D.resize(m);
+			P.resize(m);
+			for (size_t i = 0; i + 1 < N; ++i) {
+				const double K = 1 + (t[i + 1] - t[i]) * k;
+				md.discount(t[i], I.subspan(i * m, m), D);
+				md.discount(t[i], t[i + 1], B.subspan(i * m, m), P);
+				for (size_t j = 0; j < m; ++j) {
+					double x = 1 - K * P[j];
+					v[j] += x > 0 ? D[j] * x : 0;
+				}
+			}
+			for (size_t j = 0; j < m; ++j) {
+				s[c].add(v[j]);
+			}
+		}, seed, block);
+
+		monte_carlo::statistics r;
+		for (const auto& si : s) {
+			r.merge(si);
+		}
+
+		return r;
+	}
+
+#ifdef _DEBUG
+	inline int simulate_test()
+	{
+		double φ = 0.04, σ = 0.01;
+		std::vector<double> t = { 0.25, 0.5, 1, 2, 3, 5 };
+		const size_t n = 100'000, N = t.size();
+		const model md(φ, σ);
+
+		// E[D_t] and moments of log D_t(t + 2) on each date
+		std::vector<std::vector<monte_carlo::statistics>> ED_(N), logD_(N);
+		size_t nb = (n + 1023) / 1024;
+		for (size_t i = 0; i < N; ++i) {
+			ED_[i].resize(nb);
+			logD_[i].resize(nb);
+		}
+		simulate(t, n, [&](size_t c, size_t m, std::span<const double> B, std::span<const double> I) {
+			std::vector<double> D(m);
+			for (size_t i = 0; i < N; ++i) {
+				md.discount(t[i], I.subspan(i * m, m), D);
+				for (double d : D) {
+					ED_[i][c].add(d);
+				}
+				md.discount(t[i], t[i] + 2, B.subspan(i * m, m), D);
+				for (double d : D) {
+					logD_[i][c].add(log(d));
+				}
+			}
+		});
+		for (size_t i = 0; i < N; ++i) {
+			monte_carlo::statistics e, l;
+			for (size_t c = 0; c < nb; ++c) {
+				e.merge(ED_[i][c]);
+				l.merge(logD_[i][c]);
+			}
+			assert(e.n == n);
+			assert(fabs(e.mean - ED(φ, σ, t[i])) < 4 * e.error());
+			auto L = logD(φ, σ, t[i], t[i] + 2);
+			assert(fabs(l.mean - L.mean()) < 4 * l.error());
+			assert(fabs(sqrt(l.variance()) / L.stddev() - 1) < 0.02);
+		}
+
+		// cap against Gaussian bond put formula: caplet = K_i put on D_{t_i}(t_{i+1}) struck at 1/K_i
+		{
+			double k = 0.04;
+			auto c = cap(φ, σ, t, k, n, 1);
+			double v = 0;
+			for (size_t i = 0; i + 1 < N; ++i) {
+				double K = 1 + (t[i + 1] - t[i]) * k;
+				double s = σ * (t[i + 1] - t[i]) * sqrt(t[i]);
+				double D0 = ED(φ, σ, t[i]), D1 = ED(φ, σ, t[i + 1]);
+				double d1 = log(D1 * K / D0) / s + s / 2;
+				v += D0 * normal::cdf(-d1 + s) - K * D1 * normal::cdf(-d1);
+			}
+			assert(fabs(c.mean - v) < 4 * c.error());
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
 } // namespace fre::ho_lee
@@ -0,0 +1,259 @@
+// fre_monte_carlo.h - parallel Monte Carlo with counter based random streams
+#pragma once
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#endif // _DEBUG
+#include "fre_parallel.h"
+
+namespace fre::monte_carlo {
+
+	// Philox4x32-10 counter based generator. J. Salmon et al., Parallel random numbers: as easy as 1, 2, 3, SC11.
+	// Output is a function of (seed, stream, counter) so each path has its own reproducible stream
+	// no matter which thread simulates it.
+	class philox {
+		static constexpr uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+		static constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+		std::array<uint32_t, 2> key;
+		std::array<uint32_t, 4> ctr; // ctr[0], ctr[1] count blocks, ctr[2], ctr[3] are the stream
+		std::array<uint32_t, 4> out;
+		unsigned i; // next word of out
+		double z; // spare normal from Box-Muller
+		bool has_z;
+	public:
+		using result_type = uint32_t;
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+		static constexpr result_type max()
+		{
+			return UINT32_MAX;
+		}
+
+		philox(uint64_t seed = 0, uint64_t stream = 0)
+			: key{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) },
+			ctr{ 0, 0, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) },
+			out{}, i(4), z(0), has_z(false)
+		{ }
+
+		// Ten rounds of Philox4x32 on counter c with key k.
+		static std::array<uint32_t, 4> block(std::array<uint32_t, 4> c, std::array<uint32_t, 2> k)
+		{
+			for (int r = 0; r < 10; ++r) {
+				uint64_t p0 = uint64_t(M0) * c[0];
+				uint64_t p1 = uint64_t(M1) * c[2];
+				c = {
+					static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<uint32_t>(p1),
+					static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<uint32_t>(p0)
+				};
+				k[0] += W0;
+				k[1] += W1;
+			}
+
+			return c;
+		}
+
+		result_type operator()()
+		{
+			if (i == 4) {
+				out = block(ctr, key);
+				if (++ctr[0] == 0) {
+					++ctr[1];
+				}
+				i = 0;
+			}
+
+			return out[i++];
+		}
+
+		// Uniform on (0, 1) with 53 random bits.
+		double uniform()
+		{
+			uint64_t a = (*this)() >> 5; // 27 bits
+			uint64_t b = (*this)() >> 6; // 26 bits
+
+			return ((a << 26) + b + 0.5) / 9007199254740992.; // 2^53
+		}
+
+		// Standard normal using Box-Muller. Each pair of uniforms gives two normals.
+		double normal()
+		{
+			if (has_z) {
+				has_z = false;
+
+				return z;
+			}
+
+			double r = std::sqrt(-2 * std::log(uniform()));
+			double t = 2 * M_PI * uniform();
+			z = r * std::sin(t);
+			has_z = true;
+
+			return r * std::cos(t);
+		}
+	};
+
+	// Count, mean, and sum of squared deviations with Welford updates and Chan et al. merges.
+	struct statistics {
+		size_t n = 0;
+		double mean = 0;
+		double m2 = 0; // sum (x_j - mean)^2
+
+		statistics& add(double x)
+		{
+			++n;
+			double d = x - mean;
+			mean += d / n;
+			m2 += d * (x - mean);
+
+			return *this;
+		}
+		statistics& merge(const statistics& s)
+		{
+			if (s.n != 0) {
+				double n_ = static_cast<double>(n + s.n);
+				double d = s.mean - mean;
+				mean += d * (s.n / n_);
+				m2 += s.m2 + d * d * (n * (s.n / n_));
+				n += s.n;
+			}
+
+			return *this;
+		}
+
+		// unbiased sample variance (1/(n - 1)) sum (x_j - mean)^2
+		double variance() const
+		{
+			return n > 1 ? m2 / (n - 1) : NAN;
+		}
+		// standard error of the mean
+		double error() const
+		{
+			return std::sqrt(variance() / n);
+		}
+	};
+
+	// Estimate E[f(g)] from n paths where f(philox& g) simulates one path.
+	// Path j uses stream philox(seed, j). Paths are grouped in chunks merged in order
+	// so the result does not depend on the number of threads.
+	template<class F>
+	inline statistics estimate(size_t n, const F& f, uint64_t seed = 0, size_t chunk = 4096)
+	{
+		const size_t m = (n + chunk - 1) / chunk;
+		std::vector<statistics> s(m);
+
+		parallel::blocks(m, [&](size_t b, size_t e) {
+			for (size_t c = b; c < e; ++c) {
+				size_t j_ = std::min(n, (c + 1) * chunk);
+				for (size_t j = c * chunk; j < j_; ++j) {
+					philox g(seed, j);
+					s[c].add(f(g));
+				}
+			}
+		}, 1);
+
+		statistics r;
+		for (const auto& si : s) {
+			r.merge(si);
+		}
+
+		return r;
+	}
+
+	namespace put {
+
+		// E[(k - F)^+] with F = f exp(s X - s^2/2) and X standard normal.
+		inline statistics value(double f, double s, double k, size_t n, uint64_t seed = 0)
+		{
+			return estimate(n, [f, s, k](philox& g) {
+				double F = f * std::exp(s * g.normal() - s * s / 2);
+
+				return k > F ? k - F : 0.;
+			}, seed);
+		}
+
+		// E[-1(F <= k) F/f], the pathwise derivative with respect to f.
+		inline statistics delta(double f, double s, double k, size_t n, uint64_t seed = 0)
+		{
+			return estimate(n, [s, k, f](philox& g) {
+				double F_f = std::exp(s * g.normal() - s * s / 2);
+
+				return f * F_f <= k ? -F_f : 0.;
+			}, seed);
+		}
+
+	} // namespace put
+
+#ifdef _DEBUG
+	inline int philox_test()
+	{
+		// Random123 known answers
+		{
+			auto c = philox::block({ 0, 0, 0, 0 }, { 0, 0 });
+			assert(c[0] == 0x6627e8d5 && c[1] == 0xe169c58d && c[2] == 0xbc57ac4c && c[3] == 0x9b00dbd8);
+		}
+		{
+			auto c = philox::block({ UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX }, { UINT32_MAX, UINT32_MAX });
+			assert(c[0] == 0x408f276d && c[1] == 0x41c83b0e && c[2] == 0xa20bc7c6 && c[3] == 0x6d5451fd);
+		}
+		{
+			philox g(1, 2), h(1, 2), k(1, 3);
+			for (int i = 0; i < 10; ++i) {
+				double u = g.uniform();
+				assert(u > 0 && u < 1);
+				assert(u == h.uniform());
+				assert(u != k.uniform());
+			}
+		}
+
+		return 0;
+	}
+	inline int statistics_test()
+	{
+		statistics a, b, c;
+		for (int i = 0; i < 100; ++i) {
+			double x = 1e8 + i % 7;
+			(i < 30 ? a : b).add(x);
+			c.add(x);
+		}
+		a.merge(b);
+		assert(a.n == c.n);
+		assert(fabs(a.mean - c.mean) < 1e-7);
+		assert(fabs(a.variance() - c.variance()) < 1e-6);
+		// one observation says nothing about the spread
+		statistics d;
+		d.add(1);
+		assert(std::isnan(d.variance()) && std::isnan(d.error()));
+		d.add(3);
+		assert(d.variance() == 2 && d.error() == 1);
+
+		return 0;
+	}
+	inline int estimate_test()
+	{
+		// exact for lognormal put with s = 0.2, f = k = 100
+		double v = 7.965567455405804;
+
+		auto p = put::value(100, 0.2, 100, 100'000, 123);
+		assert(p.n == 100'000);
+		assert(fabs(p.mean - v) < 4 * p.error());
+
+		// same answer for a different chunking
+		auto q = estimate(100'000, [](philox& g) {
+			double F = 100 * std::exp(0.2 * g.normal() - 0.02);
+
+			return F < 100 ? 100 - F : 0.;
+		}, 123, 1000);
+		assert(fabs(q.mean - p.mean) < 1e-12);
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fre::monte_carlo
@@ -2,25 +2,241 @@
 #pragma once
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <span>
+#include <utility>
+#ifdef _DEBUG
+#include <cassert>
+#endif // _DEBUG
+#include "../xll/xll/ensure.h"
 
 // standard normal distribution
 namespace fre::normal {
 
+	// 1/sqrt(2 pi)
+	constexpr double M_1_SQRT2PI = 0.39894228040143267794;
+
+	// W. J. Cody, Algorithm 715, ACM TOMS 19 (1993), ANORM.
+	// Rational Chebyshev approximations with relative error about 1e-15.
+	namespace cody {
+
+		// P(Z <= x) = 1/2 + x a(x^2)/b(x^2) for |x| <= 0.66291
+		constexpr double a[5] = {
+			2.2352520354606839287e00, 1.6102823106855587881e02, 1.0676894854603709582e03,
+			1.8154981253343561249e04, 6.5682337918207449113e-2 };
+		constexpr double b[4] = {
+			4.7202581904688241870e01, 9.7609855173777669322e02, 1.0260932208618978205e04,
+			4.5507789335026729956e04 };
+		// P(Z <= -y) = exp(-y^2/2) c(y)/d(y) for 0.66291 < y <= sqrt(32)
+		constexpr double c[9] = {
+			3.9894151208813466764e-1, 8.8831497943883759412e00, 9.3506656132177855979e01,
+			5.9727027639480026226e02, 2.4945375852903726711e03, 6.8481904505362823326e03,
+			1.1602651437647350124e04, 9.8427148383839780218e03, 1.0765576773720192317e-8 };
+		constexpr double d[8] = {
+			2.2266688044328115691e01, 2.3538790178262499861e02, 1.5193775994075548050e03,
+			6.4855582982667607550e03, 1.8615571640885098091e04, 3.4900952721145977266e04,
+			3.8912003286093271411e04, 1.9685429676859990727e04 };
+		// P(Z <= -y) = exp(-y^2/2) (1/sqrt(2 pi) - p(1/y^2)/q(1/y^2)/y^2)/y for y > sqrt(32)
+		constexpr double p[6] = {
+			2.1589853405795699e-1, 1.274011611602473639e-1, 2.2235277870649807e-2,
+			1.421619193227893466e-3, 2.9112874951168792e-5, 2.307344176494017303e-2 };
+		constexpr double q[5] = {
+			1.28426009614491121e00, 4.68238212480865118e-1, 6.59881378689285515e-2,
+			3.78239633202758244e-3, 7.29751555083966205e-5 };
+
+		constexpr double x0 = 0.66291;
+		constexpr double x1 = 5.65685424949238019520; // sqrt(32)
+
+		// x a(x^2)/b(x^2)
+		inline double center(double x)
+		{
+			double x2 = x * x;
+			double num = a[4] * x2;
+			double den = x2;
+			for (int i = 0; i < 3; ++i) {
+				num = (num + a[i]) * x2;
+				den = (den + b[i]) * x2;
+			}
+
+			return x * (num + a[3]) / (den + b[3]);
+		}
+
+		// P(Z <= -y) exp(y^2/2) for y > x0
+		inline double tail(double y)
+		{
+			double r;
+
+			if (y <= x1) {
+				double num = c[8] * y;
+				double den = y;
+				for (int i = 0; i < 7; ++i) {
+					num = (num + c[i]) * y;
+					den = (den + d[i]) * y;
+				}
+				r = (num + c[7]) / (den + d[7]);
+			}
+			else {
+				double y2 = 1 / (y * y);
+				double num = p[5] * y2;
+				double den = y2;
+				for (int i = 0; i < 4; ++i) {
+					num = (num + p[i]) * y2;
+					den = (den + q[i]) * y2;
+				}
+				r = y2 * (num + p[4]) / (den + q[4]);
+				r = (M_1_SQRT2PI - r) / y;
+			}
+
+			return r;
+		}
+
+		// exp(-y^2/2) with y^2 split in the far tail where rounding y^2 loses digits
+		inline double gauss(double y)
+		{
+			if (y <= x1) {
+				return exp(-y * y / 2);
+			}
+
+			double y_ = trunc(16 * y) / 16;
+			double dy = (y - y_) * (y + y_);
+
+			return exp(-y_ * y_ / 2) * exp(-dy / 2);
+		}
+
+	} // namespace cody
+
 	// standard normal share density function
 	inline double pdf(double x, double s = 0)
 	{
 		x = x - s;
 
-		return exp(-x * x / 2) / sqrt(2 * M_PI);
+		return M_1_SQRT2PI * exp(-x * x / 2);
 	}
 	// standard normal cumulative share distribution function
 	// P^s(Z <= x) = P(Z <= x - s)
 	inline double cdf(double x, double s = 0)
 	{
 		x = x - s;
+		double y = fabs(x);
+
+		if (y <= cody::x0) {
+			return 0.5 + cody::center(x);
+		}
+
+		double p = cody::gauss(y) * cody::tail(y); // P(Z <= -y)
+
+		return x > 0 ? 1 - p : p;
+	}
+	// P^s(Z <= x) and the share density sharing the exponential
+	inline std::pair<double, double> cdf_pdf(double x, double s = 0)
+	{
+		x = x - s;
+		double y = fabs(x);
+		double e = cody::gauss(y); // exp(-x^2/2)
+
+		if (y <= cody::x0) {
+			return { 0.5 + cody::center(x), M_1_SQRT2PI * e };
+		}
+
+		double p = e * cody::tail(y);
+
+		return { x > 0 ? 1 - p : p, M_1_SQRT2PI * e };
+	}
+	// p[i] = P^s(Z <= x[i])
+	inline void cdf(std::span<const double> x, std::span<double> p, double s = 0)
+	{
+		ensure(x.size() == p.size());
+
+		for (size_t i = 0; i < x.size(); ++i) {
+			p[i] = cdf(x[i], s);
+		}
+	}
+	// p[i] = share density at x[i]
+	inline void pdf(std::span<const double> x, std::span<double> p, double s = 0)
+	{
+		ensure(x.size() == p.size());
+
+		for (size_t i = 0; i < x.size(); ++i) {
+			p[i] = pdf(x[i], s);
+		}
+	}
+	// Inverse standard normal cumulative distribution function, P(Z <= x) = p.
+	// P. J. Acklam's rational approximation refined by one Halley step.
+	inline double inv(double p)
+	{
+		static constexpr double a[6] = {
+			-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+			1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+		static constexpr double b[5] = {
+			-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+			6.680131188771972e+01, -1.328068155288572e+01 };
+		static constexpr double c[6] = {
+			-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+			-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+		static constexpr double d[4] = {
+			7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+			3.754408661907416e+00 };
+		constexpr double p0 = 0.02425;
+
+		if (!(p > 0 && p < 1)) {
+			return p == 0 ? -INFINITY : p == 1 ? INFINITY : NAN;
+		}
+
+		double x;
+		if (p < p0 || p > 1 - p0) {
+			double q = sqrt(-2 * log(p < p0 ? p : 1 - p));
+			x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+				/ ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+			if (p > 1 - p0) {
+				x = -x;
+			}
+		}
+		else {
+			double q = p - 0.5;
+			double r = q * q;
+			x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+				/ (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+		}
+
+		// x' = x - u/(1 + x u/2), u = (cdf(x) - p)/pdf(x)
+		double u = (cdf(x) - p) / pdf(x);
+
+		return x - u / (1 + x * u / 2);
+	}
+#ifdef _DEBUG
+	inline int inv_test()
+	{
+		for (double p = 1e-300; p < 0.5; p *= (p < 1e-3 ? 10 : 1.01)) {
+			double x = inv(p);
+			assert(fabs(cdf(x) - p) <= 1e-12 * p);
+			if (p > 1e-6) { // 1 - p rounds
+				assert(fabs(inv(1 - p) + x) <= 1e-8 * fabs(x));
+			}
+		}
+		assert(inv(0.5) == 0);
+
+		return 0;
+	}
+#endif // _DEBUG
+#ifdef _DEBUG
+	inline int cdf_test()
+	{
+		for (double x = -30; x <= 10; x += 0.01) {
+			double p = erfc(-x / M_SQRT2) / 2;
+			double p_ = cdf(x);
+			assert(fabs(p - p_) <= 2e-16);
+			assert(fabs(p - p_) <= 1e-12 * p); // erfc(-x/sqrt(2)) loses digits from rounding x/sqrt(2)
+			auto [c, d] = cdf_pdf(x);
+			assert(c == p_);
+			assert(fabs(d - pdf(x)) <= 1e-16);
+		}
+		assert(cdf(0) == 0.5);
+		assert(cdf(1, 1) == 0.5);
+		assert(cdf(-40) == 0);
+		assert(cdf(40) == 1);
 
-		return erfc(-x / M_SQRT2) / 2;
+		return 0;
 	}
+#endif // _DEBUG
 	// standard normal cumulant generating function
 	inline double cgf(double s)
 	{
@@ -5,20 +5,32 @@
 // F = f exp(sX - kappa(s)), where kappa(s) = log E[e^{sX}] is the cumulant of X.
 // If E[X] = 0 and Var(X) = 1, then E[F] = f and Var(log F) = s^2.
 #pragma once
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 #include <random>
+#include <span>
 #include <valarray>
 #include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#include "fre_black.h"
+#endif // _DEBUG
 #include "fre_variate.h"
 
 namespace fre::option {
 
 	// F <= k iff X <= (log(k/f) + kappa(s))/s 
-	inline double moneyness(double f, double s, double k, const variate::nvi& v = variate::normal{})
+	template<variate::cumulant V = variate::standard_normal>
+	inline double moneyness(double f, double s, double k, const V& v = V{})
 	{
 		return (std::log(k / f) + v.cgf(s)) / s;
 	}
+	// Virtual dispatch for handles to variates.
+	inline double moneyness(double f, double s, double k, const variate::nvi& v)
+	{
+		return moneyness<variate::nvi>(f, s, k, v);
+	}
 
 	namespace put {
 
@@ -26,20 +38,149 @@ namespace fre::option {
 		//              = k P(F <= k) - E[F 1(F <= k)]
 		//              = k P(F <= k) - E[F] E(F/E[F] 1(F <= k)]
 		//              = k P(F <= k) - f P_s(F <= k)]
-		inline double value(double f, double s, double k, const variate::nvi& v = variate::normal{})
+		template<variate::cumulant V = variate::standard_normal>
+		inline double value(double f, double s, double k, const V& v = V{})
 		{
 			double z = moneyness(f, s, k, v);
 
 			return k * v.cdf(z, 0) - f * v.cdf(z, s);
 		}
+		inline double value(double f, double s, double k, const variate::nvi& v)
+		{
+			return value<variate::nvi>(f, s, k, v);
+		}
 
 		// (d/df) E[(k - F)^+] = E[-1(F <= k) dF/df] = -P_s(F <= k)
-		inline double delta(double f, double s, double k, const variate::nvi& v = variate::normal{})
+		template<variate::cumulant V = variate::standard_normal>
+		inline double delta(double f, double s, double k, const V& v = V{})
 		{
 			double z = moneyness(f, s, k, v);
 
 			return -v.cdf(z, s);
 		}
+		inline double delta(double f, double s, double k, const variate::nvi& v)
+		{
+			return delta<variate::nvi>(f, s, k, v);
+		}
+
+		// Values and deltas of puts on a strike chain. kappa(s) is computed once.
+		template<variate::cumulant V = variate::standard_normal>
+		inline void chain(double f, double s, std::span<const double> k,
+			std::span<double> v, std::span<double> d, const V& X = V{})
+		{
+			ensure(v.size() == k.size() && d.size() == k.size());
+
+			const double kappa = X.cgf(s);
+			for (size_t i = 0; i < k.size(); ++i) {
+				double z = (std::log(k[i] / f) + kappa) / s;
+				double Ps = X.cdf(z, s);
+				v[i] = k[i] * X.cdf(z, 0) - f * Ps;
+				d[i] = -Ps;
+			}
+		}
+		// Discrete variates sweep sorted atoms and sorted strikes together in O(K + atoms).
+		// P(X <= z) and P_s(X <= z) = sum_{x_j <= z} p_j exp(s x_j - kappa(s)) accumulate as z increases.
+		inline void chain(double f, double s, std::span<const double> k,
+			std::span<double> v, std::span<double> d, const variate::discrete& X)
+		{
+			ensure(v.size() == k.size() && d.size() == k.size());
+			ensure(s > 0); // z is increasing in k
+
+			std::vector<size_t> o(k.size());
+			std::iota(o.begin(), o.end(), size_t(0));
+			if (!std::is_sorted(k.begin(), k.end())) {
+				std::sort(o.begin(), o.end(), [k](size_t i, size_t j) { return k[i] < k[j]; });
+			}
+
+			const double kappa = X.cgf(s);
+			auto x = X.atoms();
+			auto p = X.probabilities();
+			double P = 0, Ps = 0;
+			size_t j = 0;
+			for (size_t i : o) {
+				double z = (std::log(k[i] / f) + kappa) / s;
+				for (; j < x.size() && x[j] <= z; ++j) {
+					P += p[j];
+					Ps += p[j] * std::exp(s * x[j] - kappa);
+				}
+				v[i] = k[i] * P - f * Ps;
+				d[i] = -Ps;
+			}
+		}
+		// Use the discrete sweep when a handle points to a discrete variate.
+		inline void chain(double f, double s, std::span<const double> k,
+			std::span<double> v, std::span<double> d, const variate::nvi& X)
+		{
+			if (auto X_ = dynamic_cast<const variate::discrete*>(&X)) {
+				chain(f, s, k, v, d, *X_);
+			}
+			else {
+				chain<variate::nvi>(f, s, k, v, d, X);
+			}
+		}
+
+#ifdef _DEBUG
+		inline int value_test()
+		{
+			const variate::normal n;
+			const variate::nvi& v = n;
+			for (double k : { 50., 90., 100., 110., 200. }) {
+				for (double s : { 0.01, 0.1, 0.5 }) {
+					double p = value(100, s, k);
+					assert(fabs(p - black::put::value(100, s, k)) <= 1e-12);
+					assert(fabs(p - value(100, s, k, v)) <= 1e-12);
+					assert(fabs(delta(100, s, k) - delta(100, s, k, v)) <= 1e-14);
+				}
+			}
+
+			return 0;
+		}
+		inline int chain_test()
+		{
+			std::vector<double> k = { 110, 80, 95, 100, 130, 60, 100.5 };
+			std::vector<double> v(k.size()), d(k.size());
+
+			chain(100, 0.2, k, v, d);
+			for (size_t i = 0; i < k.size(); ++i) {
+				assert(v[i] == value(100, 0.2, k[i]));
+				assert(d[i] == delta(100, 0.2, k[i]));
+			}
+
+			std::vector<double> x = { 0.5, -1, 2, 0, 3, -0.5 };
+			std::vector<double> p = { 0.1, 0.25, 0.05, 0.35, 0.1, 0.15 };
+			variate::discrete X(x.size(), x.data(), p.data());
+			for (double s : { 0.05, 0.2, 1. }) {
+				chain(100, s, k, v, d, static_cast<const variate::nvi&>(X));
+				for (size_t i = 0; i < k.size(); ++i) {
+					assert(fabs(v[i] - value(100, s, k[i], X)) <= 1e-12);
+					assert(fabs(d[i] - delta(100, s, k[i], X)) <= 1e-14);
+				}
+			}
+			// strikes in decreasing order give the same values
+			{
+				std::vector<double> k_(k.rbegin(), k.rend()), v_(k.size()), d_(k.size());
+				chain(100, 0.2, k, v, d, X);
+				chain(100, 0.2, k_, v_, d_, X);
+				for (size_t i = 0; i < k.size(); ++i) {
+					assert(v_[k.size() - 1 - i] == v[i]);
+					assert(d_[k.size() - 1 - i] == d[i]);
+				}
+			}
+			// sweep needs s > 0
+			for (double s : { 0., -0.2 }) {
+				bool thrown = false;
+				try {
+					chain(100, s, k, v, d, X);
+				}
+				catch (const std::exception&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
 
 	} // namespace put
 
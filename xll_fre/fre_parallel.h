@@ -0,0 +1,99 @@
+// fre_parallel.h - split loops across hardware threads
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#include <stdexcept>
+#endif // _DEBUG
+
+namespace fre::parallel {
+
+	// Number of threads for n items with at least m items per thread.
+	inline size_t threads(size_t n, size_t m = 1)
+	{
+		size_t p = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+		return std::clamp<size_t>(n / std::max<size_t>(m, 1), 1, p);
+	}
+
+	// Call f(b, e) on contiguous blocks [b, e) partitioning [0, n), one block per thread.
+	// The calling thread runs the first block. If any call to f throws, the exception from
+	// the lowest block is rethrown after every thread has joined.
+	template<class F>
+	inline void blocks(size_t n, const F& f, size_t m = 1024)
+	{
+		const size_t p = threads(n, m);
+		if (p == 1) {
+			f(size_t(0), n);
+
+			return;
+		}
+
+		std::vector<std::exception_ptr> ex(p);
+		auto run = [&f, &ex, n, p](size_t i) {
+			try {
+				f(i * n / p, (i + 1) * n / p);
+			}
+			catch (...) {
+				ex[i] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> ts;
+		ts.reserve(p - 1);
+		try {
+			for (size_t i = 1; i < p; ++i) {
+				ts.emplace_back(run, i);
+			}
+			run(0);
+		}
+		catch (...) { // thread creation failed
+			ex[0] = std::current_exception();
+		}
+		for (auto& t : ts) {
+			t.join();
+		}
+		for (const auto& e : ex) {
+			if (e) {
+				std::rethrow_exception(e);
+			}
+		}
+	}
+
+#ifdef _DEBUG
+	inline int blocks_test()
+	{
+		// every item visited once
+		{
+			std::vector<int> v(10'000);
+			blocks(v.size(), [&v](size_t b, size_t e) {
+				for (size_t i = b; i < e; ++i) {
+					++v[i];
+				}
+			}, 1);
+			assert(std::all_of(v.begin(), v.end(), [](int i) { return i == 1; }));
+		}
+		// exceptions reach the caller from any block
+		for (size_t j : { size_t(0), size_t(9'999) }) {
+			bool thrown = false;
+			try {
+				blocks(10'000, [j](size_t b, size_t e) {
+					if (b <= j && j < e) {
+						throw std::runtime_error("blocks_test");
+					}
+				}, 1);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fre::parallel
@@ -16,8 +16,12 @@
 #include <limits>
 #include <numeric>
 #include <iterator>
+#include <span>
 #include <vector>
 #include "../xll/xll/ensure.h"
+#ifdef _DEBUG
+#include <cassert>
+#endif // _DEBUG
 
 namespace fre {
 	namespace pwflat {
@@ -99,7 +103,17 @@ namespace fre {
 		class curve {
 			std::vector<T> t;
 			std::vector<F> f;
+			std::vector<F> I; // I[i] = int_0^t[i] f(s) ds
 			F _f;
+
+			// prefix sums of integral at knots starting at index i
+			void accumulate(size_t i = 0)
+			{
+				I.resize(t.size());
+				for (; i < t.size(); ++i) {
+					I[i] = (i == 0 ? 0 : I[i - 1]) + f[i] * (t[i] - (i == 0 ? 0 : t[i - 1]));
+				}
+			}
 		public:
 			// constant forward f
 			constexpr curve(F f = NaN<F>)
@@ -109,11 +123,13 @@ namespace fre {
 				: t(t_, t_ + n), f(f_, f_ + n), _f(_f)
 			{
 				ensure(ok());
+				accumulate();
 			}
 			constexpr curve(const std::vector<T>& t, const std::vector<F>& f, F _f = NaN<F>)
 				: t(t), f(f), _f(_f)
 			{
 				ensure(ok());
+				accumulate();
 			}
 			constexpr curve(const curve&) = default;
 			constexpr curve& operator=(const curve&) = default;
@@ -159,6 +175,7 @@ namespace fre {
 
 				t.push_back(t_);
 				f.push_back(f_);
+				accumulate(t.size() - 1);
 
 				return *this;
 			}
@@ -167,7 +184,7 @@ namespace fre {
 			{
 				return _f;
 			}
-			// Set extrapolated value.
+			// Set extrapolated value. Knot integrals do not depend on it.
 			constexpr curve& extrapolate(F f_)
 			{
 				_f = f_;
@@ -183,19 +200,149 @@ namespace fre {
 			{
 				return value(u);
 			}
+			// int_0^u f(t) dt using one binary search of the knots
 			constexpr F integral(T u) const
 			{
-				return pwflat::integral(u, t.size(), t.data(), f.data(), _f);
+				return integral(u, index(u));
 			}
 			constexpr F discount(T u) const
 			{
-				return pwflat::discount(u, t.size(), t.data(), f.data(), _f);
+				return exp(-integral(u));
 			}
+			// r(u) = f(u) if u <= t[0]
 			constexpr F spot(T u) const
 			{
-				return pwflat::spot(u, t.size(), t.data(), f.data(), _f);
+				return spot(u, index(u));
+			}
+
+			// Bulk evaluation at times u. Sorted times use one merge pass over knots and times,
+			// otherwise times are visited in sorted order. It is safe to have out alias u.
+			void values(std::span<const T> u, std::span<F> out) const
+			{
+				sweep(u, out, [this](T ui, size_t i) { return value(ui, i); });
+			}
+			void discounts(std::span<const T> u, std::span<F> out) const
+			{
+				sweep(u, out, [this](T ui, size_t i) { return exp(-integral(ui, i)); });
+			}
+			void spots(std::span<const T> u, std::span<F> out) const
+			{
+				sweep(u, out, [this](T ui, size_t i) { return spot(ui, i); });
+			}
+		private:
+			// t[i-1] < u <= t[i]
+			constexpr size_t index(T u) const
+			{
+				return std::lower_bound(t.begin(), t.end(), u) - t.begin();
+			}
+			// evaluate given i = index(u)
+			constexpr F value(T u, size_t i) const
+			{
+				return u < 0 ? NaN<F> : i == t.size() ? _f : f[i];
+			}
+			constexpr F integral(T u, size_t i) const
+			{
+				if (u < 0)
+					return NaN<F>;
+				if (u == 0)
+					return 0;
+
+				const size_t n = t.size();
+				if (i == n) {
+					if (n == 0)
+						return u * _f;
+					if (u - t.back() <= std::numeric_limits<T>::epsilon())
+						return I.back();
+
+					return I.back() + _f * (u - t.back());
+				}
+
+				return i == 0 ? f[0] * u : I[i - 1] + f[i] * (u - t[i - 1]);
+			}
+			constexpr F spot(T u, size_t i) const
+			{
+				return size() == 0 ? _f : u <= t[0] ? value(u, i) : integral(u, i) / u;
+			}
+			template<class G>
+			void sweep(std::span<const T> u, std::span<F> out, const G& g) const
+			{
+				ensure(u.size() == out.size());
+
+				const size_t n = t.size();
+				size_t i = 0; // knot index
+				if (std::is_sorted(u.begin(), u.end())) {
+					for (size_t j = 0; j < u.size(); ++j) {
+						while (i < n && t[i] < u[j]) {
+							++i;
+						}
+						out[j] = g(u[j], i);
+					}
+				}
+				else {
+					std::vector<size_t> k(u.size());
+					std::iota(k.begin(), k.end(), 0);
+					std::sort(k.begin(), k.end(), [u](size_t a, size_t b) { return u[a] < u[b]; });
+					for (size_t j : k) {
+						while (i < n && t[i] < u[j]) {
+							++i;
+						}
+						out[j] = g(u[j], i);
+					}
+				}
 			}
 		};
+#ifdef _DEBUG
+		inline int curve_test()
+		{
+			double t[] = { 1, 2, 3.5, 5, 10 };
+			double f[] = { 0.01, 0.02, 0.015, 0.03, 0.025 };
+			curve<> c(0.04);
+			assert(c.integral(2) == 0.08);
+			for (size_t i = 0; i < 5; ++i) {
+				c.extend(t[i], f[i]);
+			}
+			for (double u = 0; u < 15; u += 0.125) {
+				double I = pwflat::integral(u, 5, t, f, 0.04);
+				assert(fabs(c.integral(u) - I) <= 1e-15);
+				assert(fabs(c.discount(u) - pwflat::discount(u, 5, t, f, 0.04)) <= 1e-15);
+				assert(fabs(c.spot(u) - pwflat::spot(u, 5, t, f, 0.04)) <= 1e-15);
+			}
+			for (double u : t) {
+				assert(fabs(c.integral(u) - pwflat::integral(u, 5, t, f, 0.04)) <= 1e-15);
+			}
+			assert(std::isnan(c.integral(-1)));
+			assert(std::isnan(curve<>(5, t, f).integral(11)));
+			assert(curve<>(5, t, f).integral(10) == c.integral(10));
+			{
+				// bulk evaluation, sorted and unsorted, in place
+				double u[] = { 0, 0.5, 1, 1, 2.5, 3.5, 7, 10, 12 };
+				double v[] = { 12, 1, 0.5, 7, 0, 3.5, 10, 2.5, 1 };
+				for (auto& w : { u, v }) {
+					double out[9];
+					c.values(std::span(w, 9), out);
+					for (size_t i = 0; i < 9; ++i) {
+						assert(out[i] == c.value(w[i]));
+					}
+					c.discounts(std::span(w, 9), out);
+					for (size_t i = 0; i < 9; ++i) {
+						assert(out[i] == c.discount(w[i]));
+					}
+					c.spots(std::span(w, 9), out);
+					for (size_t i = 0; i < 9; ++i) {
+						assert(out[i] == c.spot(w[i]));
+					}
+				}
+				double w[9];
+				std::copy(v, v + 9, w);
+				c.discounts(std::span(w, 9), w);
+				for (size_t i = 0; i < 9; ++i) {
+					assert(w[i] == c.discount(v[i]));
+				}
+			}
+
+			return 0;
+		}
+#endif // _DEBUG
 
 	} // namespace pwflat
 } // namespace fms
\ No newline at end of file
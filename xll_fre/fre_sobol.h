@@ -0,0 +1,430 @@
+// fre_sobol.h - Sobol low discrepancy sequences and Brownian bridge paths
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#endif // _DEBUG
+#include "../xll/xll/ensure.h"
+#include "fre_monte_carlo.h"
+#include "fre_normal.h"
+#include "fre_parallel.h"
+#include "fre_sobol_table.h"
+
+namespace fre::sobol {
+
+	// x^s mod p over GF(2) for polynomials stored as bits
+	inline uint32_t mulmod(uint32_t a, uint32_t b, uint32_t p, unsigned s)
+	{
+		uint32_t c = 0;
+		while (b) {
+			if (b & 1) {
+				c ^= a;
+			}
+			b >>= 1;
+			a <<= 1;
+			if (a >> s) {
+				a ^= p;
+			}
+		}
+
+		return c;
+	}
+	inline uint32_t powmod(uint64_t e, uint32_t p, unsigned s)
+	{
+		uint32_t r = 1, x = 2; // x is the polynomial x
+		if (s == 1) {
+			x = 1; // x = 1 mod x + 1
+		}
+		while (e) {
+			if (e & 1) {
+				r = mulmod(r, x, p, s);
+			}
+			x = mulmod(x, x, p, s);
+			e >>= 1;
+		}
+
+		return r;
+	}
+	// p of degree s is primitive if x has order 2^s - 1 mod p
+	inline bool primitive(uint32_t p, unsigned s)
+	{
+		const uint64_t n = (uint64_t(1) << s) - 1;
+		if (powmod(n, p, s) != 1) {
+			return false;
+		}
+		uint64_t m = n;
+		for (uint64_t q = 2; q * q <= m; ++q) {
+			if (m % q == 0) {
+				if (powmod(n / q, p, s) == 1) {
+					return false;
+				}
+				while (m % q == 0) {
+					m /= q;
+				}
+			}
+		}
+
+		return m == 1 || m == n || powmod(n / m, p, s) != 1;
+	}
+
+	// Direction numbers v[32 j + k] for dimension j, bit k.
+	// Dimension 0 is van der Corput. Dimension j > 0 uses the primitive polynomial and initial m_k
+	// of joe_kuo_table[j - 1], so all dimensions have the Joe-Kuo two dimensional projections.
+	inline std::vector<uint32_t> directions(size_t d)
+	{
+		ensure(d <= std::size(joe_kuo_table) + 1);
+
+		std::vector<uint32_t> v(32 * d);
+		for (unsigned k = 0; k < 32; ++k) {
+			v[k] = uint32_t(1) << (31 - k);
+		}
+
+		for (size_t j = 1; j < d; ++j) {
+			const auto& [s, a, m0] = joe_kuo_table[j - 1];
+			std::vector<uint32_t> m(m0, m0 + s);
+			m.resize(32);
+			// m_k = 2 a_1 m_{k-1} ^ 4 a_2 m_{k-2} ^ ... ^ 2^s m_{k-s} ^ m_{k-s}
+			for (unsigned k = s; k < 32; ++k) {
+				uint32_t mk = m[k - s] ^ (m[k - s] << s);
+				for (unsigned i = 1; i < s; ++i) {
+					if ((a >> (s - 1 - i)) & 1) {
+						mk ^= m[k - i] << i;
+					}
+				}
+				m[k] = mk;
+			}
+			for (unsigned k = 0; k < 32; ++k) {
+				v[32 * j + k] = m[k] << (31 - k);
+			}
+		}
+
+		return v;
+	}
+
+	// Hash based nested uniform (Owen) scrambling. B. Burley, Practical Hash-based Owen Scrambling, JCGT 2020.
+	// Each output bit depends only on the same and more significant input bits.
+	inline uint32_t owen(uint32_t x, uint32_t seed)
+	{
+		auto reverse = [](uint32_t y) {
+			y = ((y >> 1) & 0x55555555) | ((y & 0x55555555) << 1);
+			y = ((y >> 2) & 0x33333333) | ((y & 0x33333333) << 2);
+			y = ((y >> 4) & 0x0F0F0F0F) | ((y & 0x0F0F0F0F) << 4);
+			y = ((y >> 8) & 0x00FF00FF) | ((y & 0x00FF00FF) << 8);
+			return (y >> 16) | (y << 16);
+		};
+
+		x = reverse(x);
+		x += seed;
+		x ^= x * 0x6c50b47c;
+		x ^= x * 0xb82f1e52;
+		x ^= x * 0xc7afe638;
+		x ^= x * 0x8d22f6e6;
+
+		return reverse(x);
+	}
+
+	// Points in [0, 1)^d in Gray code order. The first 2^m points of each dimension
+	// hit every interval [i/2^m, (i+1)/2^m) once.
+	class sequence {
+		size_t d;
+		std::vector<uint32_t> v; // direction numbers
+		std::vector<uint32_t> x; // current point
+		std::vector<uint32_t> h; // per dimension scramble seeds, empty if not scrambled
+		uint32_t n; // index of next point
+	public:
+		sequence(size_t d)
+			: d(d), v(directions(d)), x(d, 0), n(0)
+		{ }
+		// Owen scrambled sequence
+		sequence(size_t d, uint32_t seed)
+			: sequence(d)
+		{
+			h.resize(d);
+			for (size_t j = 0; j < d; ++j) {
+				uint64_t z = (uint64_t(seed) << 32 | j) + 0x9e3779b97f4a7c15;
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+				h[j] = static_cast<uint32_t>(z ^ (z >> 31));
+			}
+		}
+
+		size_t dimension() const
+		{
+			return d;
+		}
+
+		// Fill u with the next point. Coordinates are centered in their 2^-32 cell so never 0 or 1.
+		void next(std::span<double> u)
+		{
+			ensure(u.size() == d);
+
+			if (n != 0) {
+				const uint32_t* vc = v.data() + std::countr_zero(n);
+				for (size_t j = 0; j < d; ++j) {
+					x[j] ^= vc[32 * j];
+				}
+			}
+			++n;
+
+			for (size_t j = 0; j < d; ++j) {
+				uint32_t y = h.empty() ? x[j] : owen(x[j], h[j]);
+				u[j] = (y + 0.5) / 4294967296.; // 2^32
+			}
+		}
+	};
+
+	// Brownian motion at times t from standard normals z using the Brownian bridge.
+	// z[0] sets B(t_n), z[1] the midpoint, and so on, so leading QMC dimensions carry the most variance.
+	class bridge {
+		static constexpr size_t npos = SIZE_MAX; // B(0) = 0
+		std::vector<size_t> i, l, r; // B[i] = wl B[l] + wr B[r] + sd z
+		std::vector<double> wl, wr, sd;
+	public:
+		bridge(std::span<const double> t)
+		{
+			const size_t n = t.size();
+			ensure(n > 0 && t[0] > 0);
+
+			auto time = [&t](size_t k) { return k == npos ? 0. : t[k]; };
+			i.push_back(n - 1);
+			l.push_back(npos);
+			r.push_back(npos);
+			wl.push_back(0);
+			wr.push_back(0);
+			sd.push_back(sqrt(t[n - 1]));
+
+			// breadth first so coarse points come first
+			std::vector<std::pair<size_t, size_t>> q = { { npos, n - 1 } };
+			for (size_t h = 0; h < q.size(); ++h) {
+				auto [a, b] = q[h];
+				size_t a_ = a == npos ? 0 : a + 1; // first unknown index
+				if (a_ >= b) {
+					continue;
+				}
+				size_t m = a_ + (b - a_ - 1) / 2;
+				double ta = time(a), tb = t[b], tm = t[m];
+				ensure(ta < tm && tm < tb);
+				i.push_back(m);
+				l.push_back(a);
+				r.push_back(b);
+				wl.push_back((tb - tm) / (tb - ta));
+				wr.push_back((tm - ta) / (tb - ta));
+				sd.push_back(sqrt((tm - ta) * (tb - tm) / (tb - ta)));
+				q.push_back({ a, m });
+				q.push_back({ m, b });
+			}
+		}
+
+		size_t size() const
+		{
+			return i.size();
+		}
+
+		// B[k] = B(t_k). B and z must not overlap.
+		void path(std::span<const double> z, std::span<double> B) const
+		{
+			ensure(z.size() == size() && B.size() == size());
+
+			for (size_t k = 0; k < i.size(); ++k) {
+				double b = sd[k] * z[k];
+				if (l[k] != npos) {
+					b += wl[k] * B[l[k]];
+				}
+				if (r[k] != npos) {
+					b += wr[k] * B[r[k]];
+				}
+				B[i[k]] = b;
+			}
+		}
+	};
+
+	// Estimate E[f(z)] for z standard normal in d dimensions from R Owen scrambled
+	// replicates of n Sobol points. Returns statistics of the R replicate means so
+	// error() is the standard error of the estimate. f(std::span<const double> z) must be thread safe.
+	template<class F>
+	inline monte_carlo::statistics estimate(size_t d, size_t n, const F& f, size_t R = 16, uint32_t seed = 1)
+	{
+		std::vector<double> m(R);
+
+		parallel::blocks(R, [&](size_t b, size_t e) {
+			std::vector<double> z(d);
+			for (size_t r = b; r < e; ++r) {
+				sequence q(d, static_cast<uint32_t>(seed * R + r));
+				double mr = 0;
+				for (size_t i = 0; i < n; ++i) {
+					q.next(z);
+					for (auto& zi : z) {
+						zi = normal::inv(zi);
+					}
+					mr += (f(std::span<const double>(z)) - mr) / (i + 1);
+				}
+				m[r] = mr;
+			}
+		}, 1);
+
+		monte_carlo::statistics s;
+		for (double mr : m) {
+			s.add(mr);
+		}
+
+		return s;
+	}
+
+	namespace put {
+
+		// BSM put value exp(-rt) E[(k - S_t)^+] with S_u = S0 exp(r u + σ B_u - σ^2 u/2)
+		// simulated on steps equal times to t with the Brownian bridge.
+		inline monte_carlo::statistics value(double r, double S0, double σ, double k, double t,
+			size_t n, size_t steps = 1, size_t R = 16, uint32_t seed = 1)
+		{
+			std::vector<double> ti(steps);
+			for (size_t i = 0; i < steps; ++i) {
+				ti[i] = t * (i + 1) / steps;
+			}
+			const bridge b(ti);
+			const double D = exp(-r * t);
+
+			return estimate(steps, n, [&](std::span<const double> z) {
+				thread_local std::vector<double> B;
+				B.resize(z.size());
+				b.path(z, B);
+				double S = S0 * exp(r * t + σ * B.back() - σ * σ * t / 2);
+
+				return S < k ? D * (k - S) : 0.;
+			}, R, seed);
+		}
+
+	} // namespace put
+
+#ifdef _DEBUG
+	inline int sequence_test()
+	{
+		// known primitive polynomials x + 1, x^2 + x + 1, x^3 + x + 1, x^3 + x^2 + 1
+		assert(primitive(0b11, 1));
+		assert(primitive(0b111, 2));
+		assert(primitive(0b1011, 3));
+		assert(primitive(0b1101, 3));
+		assert(!primitive(0b1111, 3));
+		assert(!primitive(0b11111, 4)); // x^4 + x^3 + x^2 + x + 1 has order 5
+		for (const auto& [s, a, m] : joe_kuo_table) {
+			assert(primitive((uint32_t(1) << s) | (uint32_t(a) << 1) | 1, s));
+		}
+
+		// no direction numbers past the table
+		{
+			bool thrown = false;
+			try {
+				directions(std::size(joe_kuo_table) + 2);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		// dimension 1 is 1/2, 3/4, 1/4, ... after 0
+		{
+			sequence s(2);
+			double u[2];
+			s.next(u);
+			assert(u[0] < 1e-9 && u[1] < 1e-9);
+			s.next(u);
+			assert(fabs(u[0] - 0.5) < 1e-9 && fabs(u[1] - 0.5) < 1e-9);
+			s.next(u);
+			assert(fabs(u[0] - 0.75) < 1e-9 && fabs(u[1] - 0.25) < 1e-9);
+		}
+
+		// stratification with and without scrambling
+		const size_t d = 300, m = 10, n = size_t(1) << m;
+		for (int scramble = 0; scramble < 2; ++scramble) {
+			sequence s = scramble ? sequence(d, 7) : sequence(d);
+			std::vector<std::vector<bool>> hit(d, std::vector<bool>(n));
+			std::vector<double> u(d);
+			for (size_t i = 0; i < n; ++i) {
+				s.next(u);
+				for (size_t j = 0; j < d; ++j) {
+					size_t c = static_cast<size_t>(u[j] * n);
+					assert(!hit[j][c]);
+					hit[j][c] = true;
+				}
+			}
+		}
+
+		// 2-d projections above dimension 16 are (6, 10, 2)-nets: every box
+		// [a/2^k1, (a + 1)/2^k1) x [b/2^k2, (b + 1)/2^k2) with k1 + k2 = 4 has 2^6 of the first 2^10 points.
+		// Random odd initial m_k give t = 9 on some of these pairs.
+		{
+			const size_t d0 = 16, d1 = 48;
+			std::vector<std::vector<uint32_t>> x(d1, std::vector<uint32_t>(n));
+			sequence s(d1);
+			std::vector<double> u(d1);
+			for (size_t i = 0; i < n; ++i) {
+				s.next(u);
+				for (size_t j = d0; j < d1; ++j) {
+					x[j][i] = static_cast<uint32_t>(u[j] * 4294967296.); // 2^32
+				}
+			}
+			for (size_t j = d0; j < d1; ++j) {
+				for (size_t k = d0; k < j; ++k) {
+					for (unsigned k1 = 0; k1 <= 4; ++k1) {
+						const unsigned k2 = 4 - k1;
+						unsigned c[16] = { 0 };
+						for (size_t i = 0; i < n; ++i) {
+							uint32_t a = k1 ? x[j][i] >> (32 - k1) : 0;
+							uint32_t b = k2 ? x[k][i] >> (32 - k2) : 0;
+							++c[a << k2 | b];
+						}
+						for (unsigned ci : c) {
+							assert(ci == 64);
+						}
+					}
+				}
+			}
+		}
+
+		return 0;
+	}
+	inline int bridge_test()
+	{
+		// covariance of B(t_i) and B(t_j) is min(t_i, t_j)
+		std::vector<double> t = { 0.1, 0.25, 0.5, 0.6, 1, 1.5, 2 };
+		bridge b(t);
+		const size_t n = t.size();
+		std::vector<double> z(n), B(n), C(n * n);
+		for (size_t k = 0; k < n; ++k) {
+			std::fill(z.begin(), z.end(), 0.);
+			z[k] = 1;
+			b.path(z, B);
+			for (size_t i = 0; i < n; ++i) {
+				for (size_t j = 0; j < n; ++j) {
+					C[i * n + j] += B[i] * B[j];
+				}
+			}
+		}
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j < n; ++j) {
+				assert(fabs(C[i * n + j] - std::min(t[i], t[j])) < 1e-14);
+			}
+		}
+
+		return 0;
+	}
+	inline int put_test()
+	{
+		double r = 0.05, S0 = 100, σ = 0.2, k = 100, t = 1;
+		double v = 5.573526022256971; // BSM put
+
+		auto p = put::value(r, S0, σ, k, t, 1 << 12, 8);
+		assert(fabs(p.mean - v) < 4 * p.error());
+		assert(p.error() < 0.01);
+
+		return 0;
+	}
+#endif // _DEBUG
+
+} // namespace fre::sobol
@@ -1,5 +1,6 @@
 // fre_test.h - test routines
 #pragma once
+#include <chrono>
 #include <random>
 #include <tuple>
 
@@ -36,6 +37,21 @@ namespace fre::test {
 		return { m, v2 - m * m };
 	}
 
+	// Return average seconds per call of f() over n calls.
+	template<class F>
+	inline double timer(const F& f, size_t n = 1)
+	{
+		volatile double sink = 0; // keep calls from being optimized away
+
+		auto t0 = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < n; ++i) {
+			sink = sink + f();
+		}
+		auto t1 = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<double>(t1 - t0).count() / n;
+	}
+
 	inline std::random_device rd;
 
 	inline double uniform(double a = 0, double b = 1)
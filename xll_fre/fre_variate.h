@@ -1,9 +1,24 @@
 // fre_variate.h: Interface to standard random variates, E[X] = 0 and Var(X) = 1.
 #pragma once
+#define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <concepts>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <random>
+#include <span>
 #include <valarray>
+#include <vector>
+#ifdef _DEBUG
+#include <cassert>
+#include <thread>
+#include <tuple>
+#endif // _DEBUG
+#include "../xll/xll/ensure.h"
+#include "fre_normal.h"
 
 namespace fre::variate {
 
@@ -15,6 +30,31 @@ namespace fre::variate {
 		return dre;
 	}
 
+	// Types with a cumulant generating function and share measure cdf.
+	// Pricing templates on these resolve statically instead of through nvi.
+	template<class V>
+	concept cumulant = requires(const V & v, double x, double s) {
+		{ v.cgf(s) } -> std::convertible_to<double>;
+		{ v.cdf(x, s) } -> std::convertible_to<double>;
+	};
+
+	// Stateless standard normal for compile time dispatch.
+	struct standard_normal {
+		static constexpr double cgf(double s)
+		{
+			return s * s / 2;
+		}
+		static std::complex<double> cgf(std::complex<double> s)
+		{
+			return s * s / 2.;
+		}
+		// P_s(X <= x) = P(X <= x - s)
+		static double cdf(double x, double s = 0)
+		{
+			return normal::cdf(x, s);
+		}
+	};
+
 	// Non Virtual Interface to random variates.
 	struct nvi {
 
@@ -27,6 +67,12 @@ namespace fre::variate {
 			return gen_();
 		}
 
+		// Fill x with random variates using one virtual call
+		void generate(std::span<double> x)
+		{
+			generate_(x);
+		}
+
 		// normalize X to have E[X] = 0 and Var(X) = 1
 		nvi& std()
 		{
@@ -47,6 +93,12 @@ namespace fre::variate {
 
 	private:
 		virtual double gen_() = 0;
+		virtual void generate_(std::span<double> x)
+		{
+			for (auto& xi : x) {
+				xi = gen_();
+			}
+		}
 		virtual nvi& std_() = 0;
 		virtual double cgf_(double s) const = 0;
 		virtual double cdf_(double x, double s) const = 0;
@@ -67,6 +119,30 @@ namespace fre::variate {
 		{
 			return n(dre);
 		}
+		// Box-Muller on a buffer of uniforms. The transform loop is unit stride
+		// with no engine calls so the compiler can use vector math.
+		void generate_(std::span<double> x) override
+		{
+			std::uniform_real_distribution<> u;
+			for (auto& xi : x) {
+				xi = 1 - u(dre); // (0, 1]
+			}
+
+			const size_t m = x.size() / 2;
+			const double mu = n.mean();
+			const double sd = n.sigma();
+			double* x0 = x.data();
+			double* x1 = x0 + m;
+			for (size_t i = 0; i < m; ++i) {
+				double r = sd * std::sqrt(-2 * std::log(x0[i]));
+				double t = 2 * M_PI * x1[i];
+				x0[i] = mu + r * std::cos(t);
+				x1[i] = mu + r * std::sin(t);
+			}
+			if (x.size() % 2) {
+				x.back() = gen_();
+			}
+		}
 
 		normal& std_() override
 		{
@@ -92,21 +168,166 @@ namespace fre::variate {
 	// Discrete random variate, P(X = x_i) = p_i
 	class discrete : public nvi {
 		std::valarray<double> x_;
-		std::discrete_distribution<> p;
+		std::valarray<double> p_; // normalized probabilities
+		// Walker alias table: column i returns atom i with probability q[i], else atom a[i]
+		std::vector<double> q;
+		std::vector<size_t> a;
+		// atoms sorted by value with probabilities and P(X <= xs[k])
+		std::vector<double> xs, ps, Ps;
+		// Tilted prefix sums P[k] = sum_{i <= k} p_i exp(s x_i - m) with m = max_i s x_i
+		// so kappa(s) = m + log P.back() does not overflow for large s.
+		struct tilt {
+			double s, m;
+			std::vector<double> P;
+		};
+		// Recently used tilts, most recent first, shared by threads calling cgf and cdf.
+		// Tilts are immutable once cached so a caller keeps its tilt after eviction. Copies start empty.
+		static constexpr size_t lru = 8;
+		struct tilt_cache {
+			std::mutex mutex;
+			std::vector<std::shared_ptr<const tilt>> v;
+
+			tilt_cache() = default;
+			tilt_cache(const tilt_cache&)
+			{ }
+			tilt_cache& operator=(const tilt_cache&)
+			{
+				clear();
+
+				return *this;
+			}
+			~tilt_cache() = default;
+
+			void clear()
+			{
+				std::lock_guard lock(mutex);
+				v.clear();
+			}
+		};
+		mutable tilt_cache tilts;
+
+		// Vose's O(n) alias table construction.
+		void alias()
+		{
+			const size_t n = p_.size();
+			q.resize(n);
+			a.resize(n);
+
+			std::vector<size_t> small, large;
+			for (size_t i = 0; i < n; ++i) {
+				q[i] = n * p_[i];
+				(q[i] < 1 ? small : large).push_back(i);
+			}
+			while (!small.empty() && !large.empty()) {
+				size_t l = small.back();
+				small.pop_back();
+				size_t g = large.back();
+				a[l] = g;
+				q[g] = (q[g] + q[l]) - 1;
+				if (q[g] < 1) {
+					large.pop_back();
+					small.push_back(g);
+				}
+			}
+			// leftovers are 1 up to rounding
+			for (size_t i : small) {
+				q[i] = 1;
+				a[i] = i;
+			}
+			for (size_t i : large) {
+				q[i] = 1;
+				a[i] = i;
+			}
+		}
+		void sort()
+		{
+			const size_t n = x_.size();
+			std::vector<size_t> k(n);
+			std::iota(k.begin(), k.end(), size_t(0));
+			std::sort(k.begin(), k.end(), [this](size_t i, size_t j) { return x_[i] < x_[j]; });
+
+			xs.resize(n);
+			ps.resize(n);
+			Ps.resize(n);
+			double P = 0;
+			for (size_t i = 0; i < n; ++i) {
+				xs[i] = x_[k[i]];
+				ps[i] = p_[k[i]];
+				P += ps[i];
+				Ps[i] = P;
+			}
+			tilts.clear();
+		}
+		// Tilted prefix sums for s, computed in O(n) on a cache miss.
+		std::shared_ptr<const tilt> tilted(double s) const
+		{
+			ensure(std::isfinite(s));
+
+			std::lock_guard lock(tilts.mutex);
+			auto& v = tilts.v;
+			auto i = std::find_if(v.begin(), v.end(), [s](const auto& t) { return t->s == s; });
+			if (i == v.end()) {
+				auto t = std::make_shared<tilt>();
+				t->s = s;
+				t->m = std::max(s * xs.front(), s * xs.back());
+				t->P.resize(xs.size());
+				double P = 0;
+				for (size_t k = 0; k < xs.size(); ++k) {
+					P += ps[k] * exp(s * xs[k] - t->m);
+					t->P[k] = P;
+				}
+				if (v.size() < lru) {
+					v.emplace_back();
+				}
+				i = v.end() - 1; // evict least recently used
+				*i = std::move(t);
+			}
+			std::rotate(v.begin(), i, i + 1);
+
+			return v.front();
+		}
+		// index of atom for uniform u in [0, 1)
+		size_t index(double u) const
+		{
+			double nu = u * q.size();
+			size_t i = std::min(static_cast<size_t>(nu), q.size() - 1);
+
+			return nu - i < q[i] ? i : a[i];
+		}
 	public:
 		discrete(size_t n, const double* x, const double* p)
-			: x_(x, n), p(p, p + n)
-		{ }
+			: x_(x, n), p_(p, n)
+		{
+			ensure(n > 0);
+			ensure(p_.min() >= 0);
+			double P = p_.sum();
+			ensure(P > 0);
+			p_ /= P;
+
+			alias();
+			sort();
+		}
 		discrete(const discrete&) = default;
 		discrete& operator=(const discrete&) = default;
 		~discrete() = default;
 
+		// atoms in increasing order
+		std::span<const double> atoms() const
+		{
+			return xs;
+		}
+		// probabilities of sorted atoms
+		std::span<const double> probabilities() const
+		{
+			return ps;
+		}
+
 		// E[f(X)] = sum_i f(x_i) p_i
 		template<class F>
 		double E(F f) const
 		{
 			return std::inner_product(begin(x_), end(x_),
-				p.probabilities().begin(), 0.0,
+				begin(p_), 0.0,
 				std::plus<double>(),
 				[f](double xi, double pi) { return f(xi) * pi; });
 		}
@@ -117,30 +338,179 @@ namespace fre::variate {
 
 			x_ -= m;
 			x_ /= sqrt(s2 - m * m);
+			sort();
 
 			return *this;
 		}
 
+		// O(1) alias sampling
 		double gen_() override
 		{
-			return x_[p(dre)];
+			std::uniform_real_distribution<> u;
+
+			return x_[index(u(dre))];
+		}
+		void generate_(std::span<double> x) override
+		{
+			std::uniform_real_distribution<> u;
+			for (auto& xi : x) {
+				xi = u(dre);
+			}
+			for (auto& xi : x) {
+				xi = x_[index(xi)];
+			}
 		}
 
 		// moment generating function of X, E[e^{sX}]
 		double mgf_(double s) const
 		{
-			return E([s](double x) { return exp(s * x); });
+			return exp(cgf_(s));
 		}
+		// log E[e^{sX}] = m + log sum_i p_i exp(s x_i - m)
 		double cgf_(double s) const override
 		{
-			return log(mgf_(s));
+			if (s == 0) {
+				return 0;
+			}
+			const auto t = tilted(s);
+
+			return t->m + log(t->P.back());
 		}
+		// Binary search of prefix sums. P_s uses the cached tilt for s.
 		double cdf_(double x, double s) const override
 		{
-			double EsX = mgf_(s);
+			size_t k = std::upper_bound(xs.begin(), xs.end(), x) - xs.begin();
+			if (k == 0) {
+				return 0;
+			}
+			if (s == 0) {
+				return Ps[k - 1];
+			}
+			const auto t = tilted(s);
 
-			return E([x, s, EsX](double y) { return (y <= x) * exp(s * y) / EsX; });
+			return t->P[k - 1] / t->P.back();
 		}
 	};
+#ifdef _DEBUG
+	inline int discrete_test()
+	{
+		std::vector<double> x = { 0.5, -1, 2, 0, 3 };
+		std::vector<double> p = { 0.1, 0.3, 0.05, 0.35, 0.2 };
+		discrete d(x.size(), x.data(), p.data());
+
+		// alias sampling frequencies
+		std::vector<double> n(x.size());
+		const size_t N = 200'000;
+		std::vector<double> y(N);
+		d.generate(y);
+		for (double yi : y) {
+			n[std::find(x.begin(), x.end(), yi) - x.begin()] += 1. / N;
+		}
+		for (size_t i = 0; i < x.size(); ++i) {
+			assert(fabs(n[i] - p[i]) < 5 * sqrt(p[i] * (1 - p[i]) / N));
+		}
+
+		// cdf against direct sums
+		for (double s : { 0., 0.3, -0.2, 0.3 }) {
+			double EsX = 0;
+			for (size_t i = 0; i < x.size(); ++i) {
+				EsX += p[i] * exp(s * x[i]);
+			}
+			for (double z : { -2., -1., 0., 0.25, 0.5, 2.5, 3., 4. }) {
+				double P = 0;
+				for (size_t i = 0; i < x.size(); ++i) {
+					P += (x[i] <= z) * p[i] * exp(s * x[i]);
+				}
+				assert(fabs(d.cdf(z, s) - P / EsX) < 1e-15);
+			}
+			assert(fabs(d.cgf(s) - log(EsX)) < 1e-15);
+		}
+
+		// large s does not overflow
+		{
+			double s = 1000;
+			double kappa = s * 3 + log(0.2); // max atom dominates
+			assert(fabs(d.cgf(s) - kappa) < 1e-12);
+			assert(d.cdf(2.5, s) < 1e-100);
+			assert(d.cdf(3, s) == 1);
+			assert(fabs(d.cgf(-s) - (s * 1 + log(0.3))) < 1e-12);
+		}
+		// cycle through more tilts than the cache holds
+		for (int i = 0; i < 3; ++i) {
+			for (double s = -1; s <= 1; s += 0.1) {
+				double EsX = 0;
+				for (size_t j = 0; j < x.size(); ++j) {
+					EsX += p[j] * exp(s * x[j]);
+				}
+				assert(fabs(d.cgf(s) - log(EsX)) < 1e-14);
+			}
+		}
+		// threads evicting each other's tilts
+		{
+			std::vector<std::thread> ts;
+			std::vector<int> ok(4, 1);
+			for (size_t j = 0; j < ok.size(); ++j) {
+				ts.emplace_back([&d, &x, &p, &ok, j]() {
+					for (int i = 0; i < 1000; ++i) {
+						double s = (i % 17 - 8) / 8. + j / 64.;
+						double EsX = 0;
+						for (size_t k = 0; k < x.size(); ++k) {
+							EsX += p[k] * exp(s * x[k]);
+						}
+						ok[j] &= fabs(d.cgf(s) - log(EsX)) < 1e-14;
+					}
+				});
+			}
+			for (auto& t : ts) {
+				t.join();
+			}
+			assert(std::all_of(ok.begin(), ok.end(), [](int i) { return i; }));
+		}
+		// non-finite tilts are not cached
+		for (double s : { NAN, INFINITY }) {
+			bool thrown = false;
+			try {
+				d.cdf(0, s);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+		// copies get their own cache
+		{
+			discrete d_(d);
+			assert(d_.cgf(0.3) == d.cgf(0.3));
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
+
+#ifdef _DEBUG
+	inline int generate_test()
+	{
+		std::vector<double> x(100'001);
+		double a[] = { -1, 0, 1 };
+		double p[] = { 0.25, 0.5, 0.25 };
+		normal n(1, 2);
+		discrete d(3, a, p);
+
+		for (auto [v, m, s2] : { std::tuple<nvi*, double, double>{ &n, 1., 4. }, { &d, 0., 0.5 } }) {
+			v->generate(x);
+			double m_ = 0, s2_ = 0;
+			for (double xi : x) {
+				m_ += xi;
+				s2_ += xi * xi;
+			}
+			m_ /= x.size();
+			s2_ = s2_ / x.size() - m_ * m_;
+			assert(fabs(m_ - m) < 5 * sqrt(s2 / x.size()));
+			assert(fabs(s2_ / s2 - 1) < 0.05);
+		}
+
+		return 0;
+	}
+#endif // _DEBUG
 
 } // namespace fre
@@ -1,5 +1,7 @@
 ﻿// xll_bachelier.h - Black model for European options.
+#include <vector>
 #include "fre_bachelier.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 using namespace fre;
@@ -7,6 +9,7 @@ using namespace xll;
 
 #ifdef _DEBUG
 int test_bachelier_put_value = bachelier::put::value_test();
+int test_bachelier_put_implied = bachelier::put::implied_test();
 #endif // _DEBUG
 
 AddIn xai_bachelier_moneyness(
@@ -44,3 +47,93 @@ double WINAPI xll_bachelier_put_value(double f, double σ, double k, double t)
 
 	return bachelier::put::value(f, σ, k, t);
 }
+
+
+AddIn xai_bachelier_put_implied(
+	Function(XLL_FPX, "xll_bachelier_put_implied", "BACHELIER.PUT.IMPLIED")
+	.Arguments({
+		Arg(XLL_FPX, "f", "is the forward price."),
+		Arg(XLL_FPX, "p", "is the put price."),
+		Arg(XLL_FPX, "k", "is the strike price."),
+		Arg(XLL_FPX, "t", "is time in years."),
+		})
+		.Category(CATEGORY)
+	.FunctionHelp("Return the bachelier put implied normal volatility. Arguments are ranges the shape of p or single values.")
+);
+_FPX* WINAPI xll_bachelier_put_implied(const _FPX* pf, const _FPX* pp, const _FPX* pk, const _FPX* pt)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		const unsigned n = size(*pp);
+		for (const _FPX* pa : { pf, pk, pt }) {
+			ensure(size(*pa) == 1 || size(*pa) == n);
+		}
+
+		result.resize(pp->rows, pp->columns);
+		for (unsigned i = 0; i < n; ++i) {
+			double f = pf->array[size(*pf) == 1 ? 0 : i];
+			double k = pk->array[size(*pk) == 1 ? 0 : i];
+			double t = pt->array[size(*pt) == 1 ? 0 : i];
+
+			result[i] = bachelier::put::implied(f, pp->array[i], k, t);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_bachelier_implied_benchmark(
+	Function(XLL_FPX, "xll_bachelier_implied_benchmark", "BACHELIER.IMPLIED.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of out-of-the-money puts."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return implied normal vols per second and worst relative vol error.")
+);
+_FPX* WINAPI xll_bachelier_implied_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		ensure(n > 0);
+
+		std::vector<double> f(n, 0.03), p(n), k(n), t(n), σ(n), σ_(n);
+		for (LONG i = 0; i < n; ++i) {
+			k[i] = test::uniform(0, f[i]);
+			t[i] = test::uniform(0.1, 30);
+			σ[i] = test::uniform(0.0001, 0.02);
+			p[i] = bachelier::put::value(f[i], σ[i], k[i], t[i]);
+		}
+
+		double dt = test::timer([&]() {
+			bachelier::put::implied(f, p, k, t, σ_);
+			return σ_[0];
+		}, 10);
+
+		double err = 0;
+		for (LONG i = 0; i < n; ++i) {
+			if (p[i] > 1e-12 * f[i]) { // price resolves vol
+				err = std::max(err, fabs(σ_[i] - σ[i]) / σ[i]);
+			}
+		}
+
+		result[0] = n / dt;
+		result[1] = err;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
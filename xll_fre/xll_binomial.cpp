@@ -1,5 +1,6 @@
 // xll_binomial.cpp - binomial model
 #include "fre_binomial.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 using namespace fre;
@@ -8,6 +9,8 @@ using namespace xll;
 #ifdef _DEBUG
 int test_random_walk = binomial::random_walk_test();
 int test_american_random_walk = binomial::american_random_walk_test();
+int test_american_put_value = binomial::american_put_value_test();
+int test_memoize = binomial::memoize_test();
 #endif // _DEBUG
 
 AddIn xai_binomial_american_put(
@@ -29,3 +32,38 @@ double WINAPI xll_binomial_american_put(double r, double S0, double sigma, doubl
 
 	return fre::binomial::american_put_value(r, S0, sigma, k, t, dt);		
 }
+
+AddIn xai_binomial_benchmark(
+	Function(XLL_FPX, "xll_binomial_benchmark", "BINOMIAL.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "N", "is the number of binomial steps."),
+		Arg(XLL_DOUBLE, "k", "is the put strike."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return nanoseconds per American lattice node for a compile time payoff and a std::function payoff.")
+);
+_FPX* WINAPI xll_binomial_benchmark(LONG N, double k)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		ensure(N > 0);
+
+		binomial::lattice l(N);
+		const binomial::payoff::put p{ k };
+		const std::function<double(double)> f = p;
+		double nodes = (N + 1.) * (N + 2.) / 2;
+
+		result[0] = 1e9 * test::timer([&]() { return l.american(p, N); }, 10) / nodes;
+		result[1] = 1e9 * test::timer([&]() { return l.american(f, N); }, 10) / nodes;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
@@ -1,5 +1,7 @@
 // xll_black.h - Black model for European options.
+#include <vector>
 #include "fre_black.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 using namespace xll;
@@ -7,6 +9,8 @@ using namespace xll;
 #ifdef _DEBUG
 int test_vega = fre::black::put::vega_test();
 int test_implied = fre::black::put::implied_test();
+int test_batch = fre::black::put::batch_test();
+int test_greeks = fre::black::put::greeks_test();
 #endif // _DEBUG
 
 AddIn xai_black_moneyness(
@@ -60,6 +64,30 @@ double WINAPI xll_black_put_delta(double f, double s, double k)
 	return fre::black::put::delta(f, s, k);
 }
 
+AddIn xai_black_put_greeks(
+	Function(XLL_FPX, "xll_black_put_greeks", "BLACK.PUT.GREEKS")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward price."),
+		Arg(XLL_DOUBLE, "s", "is the volatility."),
+		Arg(XLL_DOUBLE, "k", "is the strike price."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the black put value, delta, gamma, and vega.")
+);
+_FPX* WINAPI xll_black_put_greeks(double f, double s, double k)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 4);
+
+	auto g = fre::black::put::greeks(f, s, k);
+	result[0] = g.value;
+	result[1] = g.delta;
+	result[2] = g.gamma;
+	result[3] = g.vega;
+
+	return result.get();
+}
+
 AddIn xai_black_put_implied(
 	Function(XLL_DOUBLE, "xll_black_put_implied", "BLACK.PUT.IMPLIED")
 	.Arguments({
@@ -110,3 +138,148 @@ double WINAPI xll_black_call_implied(double f, double p, double k)
 
 	return fre::black::call::implied(f, p, k);
 }
+
+AddIn xai_black_benchmark(
+	Function(XLL_FPX, "xll_black_benchmark", "BLACK.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of options to price."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return put value, delta, and vega options per second for batch and scalar pricing on one core.")
+);
+_FPX* WINAPI xll_black_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		ensure(n > 0);
+
+		std::vector<double> f(n, 100), s(n), k(n), v(n), d(n), dv(n);
+		for (LONG i = 0; i < n; ++i) {
+			s[i] = fre::test::uniform(0.05, 0.5);
+			k[i] = fre::test::uniform(50, 150);
+		}
+
+		double tb = fre::test::timer([&]() {
+			fre::black::put::batch(f, s, k, v, d, dv);
+			return v[0];
+		}, 10);
+		double ts = fre::test::timer([&]() {
+			for (LONG i = 0; i < n; ++i) {
+				v[i] = fre::black::put::value(f[i], s[i], k[i]);
+				d[i] = fre::black::put::delta(f[i], s[i], k[i]);
+				dv[i] = fre::black::put::vega(f[i], s[i], k[i]);
+			}
+			return v[0];
+		}, 10);
+
+		result[0] = n / tb;
+		result[1] = n / ts;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_black_implied_benchmark(
+	Function(XLL_FPX, "xll_black_implied_benchmark", "BLACK.IMPLIED.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of out-of-the-money puts in the grid."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return implied vols per second and worst relative vol error for strikes in [1, 100] and vols in [0.01, 3].")
+);
+_FPX* WINAPI xll_black_implied_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		ensure(n > 0);
+
+		std::vector<double> f(n, 100), s(n), k(n), p(n), s_(n);
+		for (LONG i = 0; i < n; ++i) {
+			k[i] = 100 * exp(-4.6 * fre::test::uniform()); // k/f in [0.01, 1]
+			s[i] = fre::test::uniform(0.01, 3);
+			p[i] = fre::black::put::value(f[i], s[i], k[i]);
+		}
+
+		double t = fre::test::timer([&]() {
+			fre::black::put::implied(f, p, k, s_);
+			return s_[0];
+		}, 10);
+
+		double err = 0;
+		for (LONG i = 0; i < n; ++i) {
+			if (p[i] > 1e-12 * k[i]) { // price resolves vol
+				err = std::max(err, fabs(s_[i] - s[i]) / s[i]);
+			}
+		}
+
+		result[0] = n / t;
+		result[1] = err;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_black_greeks_benchmark(
+	Function(XLL_FPX, "xll_black_greeks_benchmark", "BLACK.GREEKS.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of options to price."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return speedup of BLACK.PUT.GREEKS over separate value, delta, gamma, and vega calls.")
+);
+_FPX* WINAPI xll_black_greeks_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 1);
+
+	try {
+		ensure(n > 0);
+
+		std::vector<double> f(n, 100), s(n), k(n);
+		std::vector<fre::black::sensitivity> g(n);
+		for (LONG i = 0; i < n; ++i) {
+			s[i] = fre::test::uniform(0.05, 0.5);
+			k[i] = fre::test::uniform(50, 150);
+		}
+
+		double tg = fre::test::timer([&]() {
+			fre::black::put::greeks(f, s, k, g);
+			return g[0].value;
+		}, 10);
+		double ts = fre::test::timer([&]() {
+			for (LONG i = 0; i < n; ++i) {
+				g[i].value = fre::black::put::value(f[i], s[i], k[i]);
+				g[i].delta = fre::black::put::delta(f[i], s[i], k[i]);
+				g[i].gamma = fre::black::put::gamma(f[i], s[i], k[i]);
+				g[i].vega = fre::black::put::vega(f[i], s[i], k[i]);
+			}
+			return g[0].value;
+		}, 10);
+
+		result[0] = ts / tg;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
@@ -1,9 +1,15 @@
 // xll_bsm.cpp - Black-Scholes-Merton model for European options.
 #include "fre_bsm.h"
+#include "fre_test.h"
 #include "xll_fre.h"	
 
 using namespace xll;
 
+#ifdef _DEBUG
+int test_bsm_greeks = fre::bsm::put::greeks_test();
+int test_bsm_path = fre::bsm::path::value_test();
+#endif // _DEBUG
+
 AddIn xai_bsm_put_value(
 	Function(XLL_DOUBLE, "xll_bsm_put_value", "BSM.PUT.VALUE")
 	.Arguments({
@@ -38,4 +44,179 @@ double WINAPI xll_bsm_put_delta(double r, double S0, double sigma, double k, dou
 {
 #pragma XLLEXPORT
 	return fre::bsm::put::delta(r, S0, sigma, k, t);
-}
\ No newline at end of file
+}
+
+AddIn xai_bsm_put_greeks(
+	Function(XLL_FPX, "xll_bsm_put_greeks", "BSM.PUT.GREEKS")
+	.Arguments({
+		Arg(XLL_DOUBLE, "r", "is the risk-free rate."),
+		Arg(XLL_DOUBLE, "S0", "is the initial stock price."),
+		Arg(XLL_DOUBLE, "sigma", "is the volatility."),
+		Arg(XLL_DOUBLE, "k", "is the strike price."),
+		Arg(XLL_DOUBLE, "t", "is the time in years to expiration."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Black-Scholes-Merton put value, delta, gamma, vega, theta, and rho.")
+);
+_FPX* WINAPI xll_bsm_put_greeks(double r, double S0, double sigma, double k, double t)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 6);
+
+	auto g = fre::bsm::put::greeks(r, S0, sigma, k, t);
+	result[0] = g.value;
+	result[1] = g.delta;
+	result[2] = g.gamma;
+	result[3] = g.vega;
+	result[4] = g.theta;
+	result[5] = g.rho;
+
+	return result.get();
+}
+
+using fre::bsm::path::model;
+namespace payoff = fre::bsm::path::payoff;
+
+// value and standard error of payoff on paths at times in pt
+template<class P>
+inline _FPX* path_value(double r, double S0, double sigma, const _FPX* pt, const P& p, LONG n)
+{
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 100'000;
+		}
+
+		model md(r, S0, sigma, std::span<const double>(pt->array, size(*pt)));
+		auto v = fre::bsm::path::value(md, p, n);
+		result[0] = v.mean;
+		result[1] = v.error();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_bsm_asian_put(
+	Function(XLL_FPX, "xll_bsm_asian_put", "BSM.ASIAN.PUT")
+	.Arguments({
+		Arg(XLL_DOUBLE, "r", "is the risk-free rate."),
+		Arg(XLL_DOUBLE, "S0", "is the initial stock price."),
+		Arg(XLL_DOUBLE, "sigma", "is the volatility."),
+		Arg(XLL_DOUBLE, "k", "is the strike price."),
+		Arg(XLL_FPX, "times", "is an array of increasing averaging times. The last is expiration."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 100000."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Monte Carlo arithmetic Asian put value and standard error.")
+);
+_FPX* WINAPI xll_bsm_asian_put(double r, double S0, double sigma, double k, const _FPX* pt, LONG n)
+{
+#pragma XLLEXPORT
+	return path_value(r, S0, sigma, pt, payoff::asian_put{ k }, n);
+}
+
+AddIn xai_bsm_barrier_down_out_put(
+	Function(XLL_FPX, "xll_bsm_barrier_down_out_put", "BSM.BARRIER.DOWN_OUT.PUT")
+	.Arguments({
+		Arg(XLL_DOUBLE, "r", "is the risk-free rate."),
+		Arg(XLL_DOUBLE, "S0", "is the initial stock price."),
+		Arg(XLL_DOUBLE, "sigma", "is the volatility."),
+		Arg(XLL_DOUBLE, "k", "is the strike price."),
+		Arg(XLL_DOUBLE, "b", "is the knock out barrier below S0."),
+		Arg(XLL_FPX, "times", "is an array of increasing monitoring times. The last is expiration."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 100000."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Monte Carlo discretely monitored down and out put value and standard error.")
+);
+_FPX* WINAPI xll_bsm_barrier_down_out_put(double r, double S0, double sigma, double k, double b, const _FPX* pt, LONG n)
+{
+#pragma XLLEXPORT
+	return path_value(r, S0, sigma, pt, payoff::down_and_out_put{ k, b }, n);
+}
+
+AddIn xai_bsm_barrier_up_out_call(
+	Function(XLL_FPX, "xll_bsm_barrier_up_out_call", "BSM.BARRIER.UP_OUT.CALL")
+	.Arguments({
+		Arg(XLL_DOUBLE, "r", "is the risk-free rate."),
+		Arg(XLL_DOUBLE, "S0", "is the initial stock price."),
+		Arg(XLL_DOUBLE, "sigma", "is the volatility."),
+		Arg(XLL_DOUBLE, "k", "is the strike price."),
+		Arg(XLL_DOUBLE, "b", "is the knock out barrier above S0."),
+		Arg(XLL_FPX, "times", "is an array of increasing monitoring times. The last is expiration."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 100000."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Monte Carlo discretely monitored up and out call value and standard error.")
+);
+_FPX* WINAPI xll_bsm_barrier_up_out_call(double r, double S0, double sigma, double k, double b, const _FPX* pt, LONG n)
+{
+#pragma XLLEXPORT
+	return path_value(r, S0, sigma, pt, payoff::up_and_out_call{ k, b }, n);
+}
+
+AddIn xai_bsm_lookback_call(
+	Function(XLL_FPX, "xll_bsm_lookback_call", "BSM.LOOKBACK.CALL")
+	.Arguments({
+		Arg(XLL_DOUBLE, "r", "is the risk-free rate."),
+		Arg(XLL_DOUBLE, "S0", "is the initial stock price."),
+		Arg(XLL_DOUBLE, "sigma", "is the volatility."),
+		Arg(XLL_FPX, "times", "is an array of increasing monitoring times. The last is expiration."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 100000."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Monte Carlo floating strike lookback call value and standard error.")
+);
+_FPX* WINAPI xll_bsm_lookback_call(double r, double S0, double sigma, const _FPX* pt, LONG n)
+{
+#pragma XLLEXPORT
+	return path_value(r, S0, sigma, pt, payoff::lookback_call{}, n);
+}
+
+AddIn xai_bsm_path_benchmark(
+	Function(XLL_FPX, "xll_bsm_path_benchmark", "BSM.PATH.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 100000."),
+		Arg(XLL_LONG, "steps", "is the number of time steps. Default is 100."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return Asian put paths per second for path major and time major buffers.")
+);
+_FPX* WINAPI xll_bsm_path_benchmark(LONG n, LONG steps)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 100'000;
+		}
+		if (steps <= 0) {
+			steps = 100;
+		}
+
+		using fre::bsm::path::layout;
+		auto t = fre::bsm::path::grid(1, steps);
+		model md(0.05, 100, 0.2, t);
+		layout ls[] = { layout::path_major, layout::time_major };
+		for (int i = 0; i < 2; ++i) {
+			result[i] = n / fre::test::timer([&]() {
+				return fre::bsm::path::value(md, payoff::asian_put{ 100 }, n, 0, ls[i]).mean;
+			});
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
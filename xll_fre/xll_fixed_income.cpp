@@ -1,5 +1,9 @@
 // xll_fixed_income.cpp - Fixed income instruments and valuation.
+#include <algorithm>
+#include <span>
+#include <vector>
 #include "fre_fixed_income.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 #undef CATEGORY
@@ -9,7 +13,10 @@ using namespace fre;
 using namespace xll;
 
 #ifdef _DEBUG
+int test_instrument = fixed_income::instrument_test();
 int test_bootstrap = fixed_income::bootstrap_test();
+int test_ladder = fixed_income::ladder_test();
+int test_portfolio = fixed_income::portfolio_test();
 #endif // _DEBUG
 
 // !!! Implement FI.INSTRUMENT 
@@ -31,7 +38,8 @@ HANDLEX WINAPI xll_instrument_(const _FPX* pu, const _FPX* pc)
 	try {
 		ensure(size(*pu) == size(*pc));
 
-		handle<fixed_income::instrument<>> c(new fixed_income::instrument(size(*pu), pu->array, pc->array));
+		fixed_income::instrument_view<> v(size(*pu), pu->array, pc->array);
+		handle<fixed_income::instrument<>> c(new fixed_income::instrument<>(v));
 		ensure(c);
 
 		h = c.get();
@@ -73,3 +81,269 @@ double WINAPI xll_present_value(HANDLEX inst, HANDLEX curve)
 
 	return result;
 }
+
+AddIn xai_present_value_cash_flows(
+	Function(XLL_DOUBLE, "xll_present_value_cash_flows", CATEGORY ".PRESENT_VALUE.CASH_FLOWS")
+	.Arguments({
+		Arg(XLL_FPX, "Time", "is an array of positive increasing times."),
+		Arg(XLL_FPX, "Cash", "is an array of cash flows."),
+		Arg(XLL_HANDLEX, "Curve", "is handle returned by \\" CATEGORY ".CURVE"),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return present value of cash flows given a curve without creating an instrument.")
+);
+double WINAPI xll_present_value_cash_flows(const _FPX* pu, const _FPX* pc, HANDLEX curve)
+{
+#pragma XLLEXPORT
+	double result = std::numeric_limits<double>::quiet_NaN();
+	try {
+		ensure(size(*pu) == size(*pc));
+		handle<pwflat::curve<>> c(curve);
+		ensure(c);
+
+		result = fixed_income::present_value(fixed_income::instrument_view<>(size(*pu), pu->array, pc->array), *c);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return result;
+}
+
+AddIn xai_risk_ladder(
+	Function(XLL_FPX, "xll_risk_ladder", CATEGORY ".RISK.LADDER")
+	.Arguments({
+		Arg(XLL_FPX, "Instruments", "is an array of handles returned by \\" CATEGORY ".INSTRUMENT"),
+		Arg(XLL_HANDLEX, "Curve", "is handle returned by \\" CATEGORY ".CURVE"),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return derivative of total present value with respect to each curve forward and the extrapolated forward.")
+);
+_FPX* WINAPI xll_risk_ladder(const _FPX* pi, HANDLEX curve)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		handle<pwflat::curve<>> c(curve);
+		ensure(c);
+
+		result.resize(1, static_cast<int>(c->size() + 1));
+		std::span<double> dpv(result.get()->array, size(*result.get()));
+		std::fill(dpv.begin(), dpv.end(), 0.);
+		for (unsigned k = 0; k < size(*pi); ++k) {
+			handle<fixed_income::instrument<>> i(pi->array[k]);
+			ensure(i);
+			fixed_income::ladder(*i, *c, dpv);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_portfolio_(
+	Function(XLL_HANDLE, "xll_portfolio_", "\\" CATEGORY ".PORTFOLIO")
+	.Arguments({
+		Arg(XLL_FPX, "Instruments", "is an array of handles returned by \\" CATEGORY ".INSTRUMENT"),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp("Return a handle to a portfolio of instruments.")
+);
+HANDLEX WINAPI xll_portfolio_(const _FPX* pi)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX; // default return value
+
+	try {
+		handle<fixed_income::portfolio<>> p(new fixed_income::portfolio<>());
+		ensure(p);
+		for (unsigned k = 0; k < size(*pi); ++k) {
+			handle<fixed_income::instrument<>> i(pi->array[k]);
+			ensure(i);
+			p->push_back(*i);
+		}
+		p->index();
+
+		h = p.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return h;
+}
+
+AddIn xai_portfolio_present_value(
+	Function(XLL_FPX, "xll_portfolio_present_value", CATEGORY ".PORTFOLIO.PRESENT_VALUE")
+	.Arguments({
+		Arg(XLL_HANDLEX, "Portfolio", "is handle returned by \\" CATEGORY ".PORTFOLIO"),
+		Arg(XLL_HANDLEX, "Curve", "is handle returned by \\" CATEGORY ".CURVE"),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return a column of instrument present values followed by the total.")
+);
+_FPX* WINAPI xll_portfolio_present_value(HANDLEX portfolio, HANDLEX curve)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		handle<fixed_income::portfolio<>> p(portfolio);
+		ensure(p);
+		handle<pwflat::curve<>> c(curve);
+		ensure(c);
+
+		const unsigned n = static_cast<unsigned>(p->size());
+		result.resize(n + 1, 1);
+		result[n] = p->present_value(*c, std::span<double>(result.get()->array, n));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_portfolio_benchmark(
+	Function(XLL_FPX, "xll_portfolio_benchmark", CATEGORY ".PORTFOLIO.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of bonds. Default is 50000."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return seconds to value n bonds one at a time and as a portfolio.")
+);
+_FPX* WINAPI xll_portfolio_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 50000;
+		}
+
+		pwflat::curve<> c({ 0.5, 1, 2, 3, 5, 7, 10, 20, 30 },
+			{ 0.02, 0.025, 0.03, 0.032, 0.035, 0.034, 0.036, 0.037, 0.035 });
+
+		// semiannual bonds with maturities up to 30 years
+		std::vector<fixed_income::instrument<>> is;
+		for (LONG k = 0; k < n; ++k) {
+			LONG m = k % 60 + 1;
+			std::vector<double> u(m), cf(m, 0.0005 * (k % 100));
+			for (LONG j = 0; j < m; ++j) {
+				u[j] = (j + 1) * 0.5;
+			}
+			cf.back() += 1;
+			is.push_back(fixed_income::instrument<>(m, u.data(), cf.data()));
+		}
+		fixed_income::portfolio<> p(is.size(), is.data());
+		std::vector<double> pv(n);
+
+		result[0] = test::timer([&]() {
+			double total = 0;
+			for (const auto& i : is) {
+				total += fixed_income::present_value(i, c);
+			}
+			return total;
+		}, 10);
+		result[1] = test::timer([&]() { return p.present_value(c, std::span<double>(pv)); }, 10);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_curve_bootstrap_(
+	Function(XLL_HANDLE, "xll_curve_bootstrap_", "\\" CATEGORY ".CURVE.BOOTSTRAP")
+	.Arguments({
+		Arg(XLL_FPX, "Instruments", "is an array of handles returned by \\" CATEGORY ".INSTRUMENT sorted by maturity."),
+		Arg(XLL_FPX, "Prices", "is an array of instrument prices."),
+		})
+	.Uncalced()
+	.Category(CATEGORY)
+	.FunctionHelp("Return a handle to a piece-wise flat forward curve repricing the instruments.")
+);
+HANDLEX WINAPI xll_curve_bootstrap_(const _FPX* pi, const _FPX* pp)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX; // default return value
+
+	try {
+		ensure(size(*pi) == size(*pp));
+
+		std::vector<fixed_income::instrument<>> is;
+		for (unsigned k = 0; k < size(*pi); ++k) {
+			handle<fixed_income::instrument<>> i(pi->array[k]);
+			ensure(i);
+			is.push_back(*i);
+		}
+
+		handle<pwflat::curve<>> c(new pwflat::curve<>());
+		ensure(c);
+		fixed_income::bootstrap(is.size(), is.data(), pp->array, *c);
+
+		h = c.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return h;
+}
+
+AddIn xai_bootstrap_benchmark(
+	Function(XLL_DOUBLE, "xll_bootstrap_benchmark", CATEGORY ".BOOTSTRAP.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of semiannual par bonds. Default is 60."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return curve builds per second.")
+);
+double WINAPI xll_bootstrap_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	double result = std::numeric_limits<double>::quiet_NaN();
+
+	try {
+		if (n <= 0) {
+			n = 60;
+		}
+
+		// bonds maturing every 6 months paying 3% semiannual coupons priced at par
+		std::vector<fixed_income::instrument<>> is;
+		std::vector<double> p(n, 1);
+		for (LONG k = 1; k <= n; ++k) {
+			std::vector<double> u(k), c(k, 0.015);
+			for (LONG j = 0; j < k; ++j) {
+				u[j] = (j + 1) * 0.5;
+			}
+			c.back() += 1;
+			is.push_back(fixed_income::instrument<>(k, u.data(), c.data()));
+		}
+
+		result = 1 / test::timer([&]() {
+			pwflat::curve<> c;
+			fixed_income::bootstrap(is.size(), is.data(), p.data(), c);
+			return c.back().second;
+		}, 100);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return result;
+}
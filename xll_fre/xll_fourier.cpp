@@ -0,0 +1,119 @@
+// xll_fourier.cpp - Fourier-cosine option pricing.
+#include "fre_black.h"
+#include "fre_fourier.h"
+#include "fre_test.h"
+#include "xll_fre.h"
+
+#undef CATEGORY
+#define CATEGORY "FOURIER"
+
+using namespace fre;
+using namespace xll;
+
+#ifdef _DEBUG
+int test_fourier_put_chain = fourier::put::chain_test();
+#endif // _DEBUG
+
+AddIn xai_fourier_put_chain(
+	Function(XLL_FPX, "xll_fourier_put_chain", CATEGORY ".PUT.CHAIN")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward price."),
+		Arg(XLL_DOUBLE, "s", "is the volatility."),
+		Arg(XLL_FPX, "k", "is an array of strike prices."),
+		Arg(XLL_DOUBLE, "θ", "is the variance gamma skew parameter."),
+		Arg(XLL_DOUBLE, "ν", "is the variance gamma kurtosis parameter. Use 0 for the normal."),
+		Arg(XLL_LONG, "N", "is the number of cosine terms. Default is 256."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return a column of put values and a column of put deltas for each strike.")
+);
+_FPX* WINAPI xll_fourier_put_chain(double f, double s, const _FPX* pk, double θ, double ν, LONG N)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		if (N <= 0) {
+			N = 256;
+		}
+
+		const unsigned n = size(*pk);
+		std::span<const double> k(pk->array, n);
+		std::vector<double> v(n), d(n);
+		if (ν > 0) {
+			fourier::put::chain(f, s, k, v, d, variate::variance_gamma{ θ, ν }, N);
+		}
+		else {
+			fourier::put::chain(f, s, k, v, d, variate::standard_normal{}, N);
+		}
+		result.resize(n, 2);
+		for (unsigned i = 0; i < n; ++i) {
+			result(i, 0) = v[i];
+			result(i, 1) = d[i];
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_fourier_benchmark(
+	Function(XLL_FPX, "xll_fourier_benchmark", CATEGORY ".BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of strikes. Default is 1000."),
+		Arg(XLL_LONG, "N", "is the number of cosine terms. Default is 128."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return the maximum absolute error against black::put::value and nanoseconds per strike for the COS chain and black::put::value.")
+);
+_FPX* WINAPI xll_fourier_benchmark(LONG n, LONG N)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 3);
+
+	try {
+		if (n <= 0) {
+			n = 1000;
+		}
+		if (N <= 0) {
+			N = 128;
+		}
+
+		// strikes from 50 to 200
+		std::vector<double> k(n), v(n), d(n);
+		for (LONG i = 0; i < n; ++i) {
+			k[i] = 50 + 150. * i / n;
+		}
+
+		fourier::put::chain(100, 0.2, k, v, d, variate::standard_normal{}, N);
+		double err = 0;
+		for (LONG i = 0; i < n; ++i) {
+			err = std::max(err, fabs(v[i] - black::put::value(100, 0.2, k[i])));
+		}
+
+		result[0] = err;
+		result[1] = 1e9 / n * test::timer([&]() {
+			fourier::put::chain(100, 0.2, k, v, d, variate::standard_normal{}, N);
+			return v[0];
+		});
+		result[2] = 1e9 / n * test::timer([&]() {
+			double p = 0;
+			for (LONG i = 0; i < n; ++i) {
+				p += black::put::value(100, 0.2, k[i]);
+			}
+			return p;
+		});
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
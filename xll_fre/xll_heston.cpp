@@ -0,0 +1,195 @@
+// xll_heston.cpp - Heston stochastic volatility add-ins.
+#include "fre_heston.h"
+#include "fre_test.h"
+#include "xll_fre.h"
+
+#undef CATEGORY
+#define CATEGORY "HESTON"
+
+using namespace fre;
+using namespace xll;
+
+#ifdef _DEBUG
+int test_heston_put_chain = heston::put::chain_test();
+int test_heston_calibrate = heston::calibrate_test();
+#endif // _DEBUG
+
+// Model from an array of v0, θ, κ, ξ, and ρ with v0, θ, κ > 0, ξ >= 0, and |ρ| < 1.
+static heston::model params(const _FPX* pm)
+{
+	ensure(size(*pm) == 5);
+	const double* m = pm->array;
+	ensure(m[0] > 0 && m[1] > 0 && m[2] > 0 && m[3] >= 0 && fabs(m[4]) < 1);
+
+	return heston::model{ m[0], m[1], m[2], m[3], m[4] };
+}
+
+AddIn xai_heston_put_chain(
+	Function(XLL_FPX, "xll_heston_put_chain", CATEGORY ".PUT.CHAIN")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward price."),
+		Arg(XLL_DOUBLE, "t", "is the time in years to expiration."),
+		Arg(XLL_FPX, "k", "is an array of strike prices."),
+		Arg(XLL_FPX, "model", "is an array of v0, θ, κ, ξ, and ρ."),
+		Arg(XLL_LONG, "N", "is the number of cosine terms. Default is 256."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return a column of put values and a column of put deltas for each strike.")
+);
+_FPX* WINAPI xll_heston_put_chain(double f, double t, const _FPX* pk, const _FPX* pm, LONG N)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		if (N <= 0) {
+			N = 256;
+		}
+
+		const unsigned n = size(*pk);
+		std::vector<double> v(n), d(n);
+		heston::put::chain(f, t, std::span<const double>(pk->array, n), v, d, params(pm), N);
+		result.resize(n, 2);
+		for (unsigned i = 0; i < n; ++i) {
+			result(i, 0) = v[i];
+			result(i, 1) = d[i];
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_heston_implied(
+	Function(XLL_FPX, "xll_heston_implied", CATEGORY ".IMPLIED")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward price."),
+		Arg(XLL_FPX, "t", "is an array of times in years to expiration."),
+		Arg(XLL_FPX, "k", "is an array of strike prices."),
+		Arg(XLL_FPX, "model", "is an array of v0, θ, κ, ξ, and ρ."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return Black implied volatilities of the model for each expiration and strike.")
+);
+_FPX* WINAPI xll_heston_implied(double f, const _FPX* pt, const _FPX* pk, const _FPX* pm)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		const unsigned n = size(*pt);
+		ensure(size(*pk) == n);
+
+		result.resize(pt->rows, pt->columns);
+		heston::implied(f, std::span<const double>(pt->array, n), std::span<const double>(pk->array, n),
+			params(pm), std::span<double>(result.get()->array, n));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_heston_calibrate(
+	Function(XLL_FPX, "xll_heston_calibrate", CATEGORY ".CALIBRATE")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward price."),
+		Arg(XLL_FPX, "t", "is an array of times in years to expiration."),
+		Arg(XLL_FPX, "k", "is an array of strike prices."),
+		Arg(XLL_FPX, "σ", "is an array of Black implied volatilities."),
+		Arg(XLL_FPX, "model", "is an initial guess of v0, θ, κ, ξ > 0, and ρ."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return v0, θ, κ, ξ, and ρ fitted to the implied volatility surface.")
+);
+_FPX* WINAPI xll_heston_calibrate(double f, const _FPX* pt, const _FPX* pk, const _FPX* pσ, const _FPX* pm)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 5);
+
+	try {
+		const unsigned n = size(*pt);
+		ensure(size(*pk) == n && size(*pσ) == n);
+
+		auto m = heston::calibrate(f, std::span<const double>(pt->array, n), std::span<const double>(pk->array, n),
+			std::span<const double>(pσ->array, n), params(pm));
+		result[0] = m.v0;
+		result[1] = m.θ;
+		result[2] = m.κ;
+		result[3] = m.ξ;
+		result[4] = m.ρ;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_heston_benchmark(
+	Function(XLL_FPX, "xll_heston_benchmark", CATEGORY ".BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "expirations", "is the number of expirations. Default is 8."),
+		Arg(XLL_LONG, "strikes", "is the number of strikes per expiration. Default is 25."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return seconds to calibrate to a synthetic surface and the maximum implied volatility error.")
+);
+_FPX* WINAPI xll_heston_benchmark(LONG expirations, LONG strikes)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (expirations <= 0) {
+			expirations = 8;
+		}
+		if (strikes <= 0) {
+			strikes = 25;
+		}
+
+		const double f = 100;
+		const heston::model m{ 0.04, 0.06, 1.5, 0.6, -0.6 };
+		// expirations to 3 years, strikes within 3 standard deviations
+		std::vector<double> t, k;
+		const double z0 = strikes > 1 ? -3 : 0, dz = strikes > 1 ? 6. / (strikes - 1) : 0;
+		for (LONG i = 0; i < expirations; ++i) {
+			const double t_ = 3. * (i + 1) / expirations;
+			for (LONG j = 0; j < strikes; ++j) {
+				t.push_back(t_);
+				k.push_back(f * std::exp(0.25 * std::sqrt(t_) * (z0 + j * dz)));
+			}
+		}
+		std::vector<double> σ(t.size()), σ_(t.size());
+		heston::implied(f, t, k, m, σ);
+
+		heston::model m_;
+		result[0] = test::timer([&]() {
+			m_ = heston::calibrate(f, t, k, σ, heston::model{ 0.02, 0.02, 1, 0.3, 0 });
+			return m_.v0;
+		});
+		heston::implied(f, t, k, m_, σ_);
+		double err = 0;
+		for (size_t i = 0; i < σ.size(); ++i) {
+			err = std::max(err, fabs(σ_[i] - σ[i]));
+		}
+		result[1] = err;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
@@ -1,10 +1,15 @@
 ﻿// xll_ho_lee.cpp - Ho-Lee interest rate add-ins
 #include "fre_ho_lee.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 using namespace fre;
 using namespace xll;
 
+#ifdef _DEBUG
+int test_ho_lee_simulate = ho_lee::simulate_test();
+#endif // _DEBUG
+
 // !!! Implement the following add-ins !!!
 // HO_LEE.ED
 // HO_LEE.Convexity
@@ -103,3 +108,74 @@ _FPX* WINAPI xll_ho_lee_convexity2(double σ, double t, double u)
 
 	return stdev.get();
 }
+
+AddIn xai_ho_lee_cap(
+	Function(XLL_FPX, "xll_ho_lee_cap", "HO_LEE.CAP")
+	.Arguments({
+		Arg(XLL_DOUBLE, "φ", "is the futures."),
+		Arg(XLL_DOUBLE, "σ", "is the volatility."),
+		Arg(XLL_FPX, "t", "is an array of increasing reset times. The last is the final payment."),
+		Arg(XLL_DOUBLE, "k", "is the cap strike."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 100000."),
+		})
+	.FunctionHelp("Return the Monte Carlo cap value and standard error.")
+	.Category(CATEGORY)
+);
+_FPX* WINAPI xll_ho_lee_cap(double φ, double σ, const _FPX* pt, double k, LONG n)
+{
+#pragma XLLEXPORT
+	static xll::FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 100'000;
+		}
+
+		auto c = ho_lee::cap(φ, σ, std::span<const double>(pt->array, size(*pt)), k, n);
+		result[0] = c.mean;
+		result[1] = c.error();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0; // #NUM!
+	}
+
+	return result.get();
+}
+
+AddIn xai_ho_lee_benchmark(
+	Function(XLL_DOUBLE, "xll_ho_lee_benchmark", "HO_LEE.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 1000000."),
+		Arg(XLL_LONG, "dates", "is the number of quarterly dates. Default is 100."),
+		})
+	.FunctionHelp("Return seconds to simulate paths and value a quarterly cap.")
+	.Category(CATEGORY)
+	.Volatile()
+);
+double WINAPI xll_ho_lee_benchmark(LONG n, LONG dates)
+{
+#pragma XLLEXPORT
+	double result = std::numeric_limits<double>::quiet_NaN();
+
+	try {
+		if (n <= 0) {
+			n = 1'000'000;
+		}
+		if (dates <= 1) {
+			dates = 100;
+		}
+
+		std::vector<double> t(dates);
+		for (LONG i = 0; i < dates; ++i) {
+			t[i] = 0.25 * (i + 1);
+		}
+		result = test::timer([&]() { return ho_lee::cap(0.04, 0.01, t, 0.04, n).mean; });
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return result;
+}
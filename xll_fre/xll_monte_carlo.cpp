@@ -0,0 +1,115 @@
+// xll_monte_carlo.cpp - Parallel Monte Carlo estimates.
+#include "fre_monte_carlo.h"
+#include "fre_test.h"
+#include "xll_fre.h"
+
+#undef CATEGORY
+#define CATEGORY "MONTE_CARLO"
+
+using namespace fre;
+using namespace xll;
+
+#ifdef _DEBUG
+int test_philox = monte_carlo::philox_test();
+int test_statistics = monte_carlo::statistics_test();
+int test_estimate = monte_carlo::estimate_test();
+int test_blocks = parallel::blocks_test();
+#endif // _DEBUG
+
+AddIn xai_monte_carlo_put_value(
+	Function(XLL_FPX, "xll_monte_carlo_put_value", CATEGORY ".PUT.VALUE")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward."),
+		Arg(XLL_DOUBLE, "s", "is the vol."),
+		Arg(XLL_DOUBLE, "k", "is the strike."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 1000000."),
+		Arg(XLL_LONG, "seed", "is the random seed. Default is 0."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Monte Carlo lognormal put value and its standard error.")
+);
+_FPX* WINAPI xll_monte_carlo_put_value(double f, double s, double k, LONG n, LONG seed)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 1'000'000;
+		}
+
+		auto v = monte_carlo::put::value(f, s, k, n, static_cast<uint64_t>(seed));
+		result[0] = v.mean;
+		result[1] = v.error();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_monte_carlo_put_delta(
+	Function(XLL_FPX, "xll_monte_carlo_put_delta", CATEGORY ".PUT.DELTA")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward."),
+		Arg(XLL_DOUBLE, "s", "is the vol."),
+		Arg(XLL_DOUBLE, "k", "is the strike."),
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 1000000."),
+		Arg(XLL_LONG, "seed", "is the random seed. Default is 0."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the Monte Carlo lognormal put delta and its standard error.")
+);
+_FPX* WINAPI xll_monte_carlo_put_delta(double f, double s, double k, LONG n, LONG seed)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 1'000'000;
+		}
+
+		auto v = monte_carlo::put::delta(f, s, k, n, static_cast<uint64_t>(seed));
+		result[0] = v.mean;
+		result[1] = v.error();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_monte_carlo_benchmark(
+	Function(XLL_DOUBLE, "xll_monte_carlo_benchmark", CATEGORY ".BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of paths. Default is 1000000."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return lognormal put paths per second.")
+);
+double WINAPI xll_monte_carlo_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	double result = std::numeric_limits<double>::quiet_NaN();
+
+	try {
+		if (n <= 0) {
+			n = 1'000'000;
+		}
+
+		result = n / test::timer([n]() { return monte_carlo::put::value(100, 0.2, 100, n).mean; });
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return result;
+}
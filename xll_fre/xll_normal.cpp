@@ -1,9 +1,16 @@
 // xll_normal.cpp - Standard normal distribution.
+#include <vector>
 #include "fre_normal.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 using namespace xll;
 
+#ifdef _DEBUG
+int test_normal_cdf = fre::normal::cdf_test();
+int test_normal_inv = fre::normal::inv_test();
+#endif // _DEBUG
+
 AddIn xai_normal_pdf(
 	Function(XLL_DOUBLE, "xll_normal_pdf", "NORMAL.PDF")
 	.Arguments({
@@ -34,4 +41,67 @@ double WINAPI xll_normal_cdf(double x, double s)
 #pragma XLLEXPORT
 
 	return fre::normal::cdf(x, s);
-}
\ No newline at end of file
+}
+AddIn xai_normal_benchmark(
+	Function(XLL_FPX, "xll_normal_benchmark", "NORMAL.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of points in [-6, 6]."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return nanoseconds per call of NORMAL.CDF, libm erfc, NORMAL.CDF plus NORMAL.PDF, and the fused cdf_pdf.")
+);
+_FPX* WINAPI xll_normal_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 4);
+
+	try {
+		ensure(n > 0);
+
+		std::vector<double> x(n);
+		for (auto& xi : x) {
+			xi = fre::test::uniform(-6, 6);
+		}
+
+		result[0] = fre::test::timer([&x]() {
+			double s = 0;
+			for (double xi : x) {
+				s += fre::normal::cdf(xi);
+			}
+			return s;
+		}, 100);
+		result[1] = fre::test::timer([&x]() {
+			double s = 0;
+			for (double xi : x) {
+				s += erfc(-xi / M_SQRT2) / 2;
+			}
+			return s;
+		}, 100);
+		result[2] = fre::test::timer([&x]() {
+			double s = 0;
+			for (double xi : x) {
+				s += fre::normal::cdf(xi) + fre::normal::pdf(xi);
+			}
+			return s;
+		}, 100);
+		result[3] = fre::test::timer([&x]() {
+			double s = 0;
+			for (double xi : x) {
+				auto [c, d] = fre::normal::cdf_pdf(xi);
+				s += c + d;
+			}
+			return s;
+		}, 100);
+		for (int i = 0; i < 4; ++i) {
+			result[i] *= 1e9 / n;
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
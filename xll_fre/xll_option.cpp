@@ -1,10 +1,17 @@
 // xll_option.cpp - Generic option pricing.
 #include "xll_fre.h"
+#include "fre_black.h"
 #include "fre_option.h"
+#include "fre_test.h"
 
 using namespace xll;
 using namespace fre;
 
+#ifdef _DEBUG
+int test_option_put_value = option::put::value_test();
+int test_option_put_chain = option::put::chain_test();
+#endif // _DEBUG
+
 AddIn xai_fre_option_moneyness(
 	Function(XLL_DOUBLE, "xll_fre_option_moneyness", "OPTION.MONENESS")
 	.Arguments({
@@ -64,3 +71,94 @@ double WINAPI xll_fre_option_put_value(double f, double s, double k, HANDLEX h)
 
 	return z;
 }
+
+AddIn xai_fre_option_put_chain(
+	Function(XLL_FPX, "xll_fre_option_put_chain", "OPTION.PUT.CHAIN")
+	.Arguments({
+		Arg(XLL_DOUBLE, "f", "is the forward price."),
+		Arg(XLL_DOUBLE, "s", "is the volatility."),
+		Arg(XLL_FPX, "k", "is an array of strike prices."),
+		Arg(XLL_HANDLEX, "handle", "is a handle to a standard variate.")
+	})
+	.FunctionHelp("Return a column of put values and a column of put deltas for each strike.")
+);
+_FPX* WINAPI xll_fre_option_put_chain(double f, double s, const _FPX* pk, HANDLEX h)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		handle<variate::nvi> h_(h);
+		ensure(h_);
+
+		const unsigned n = size(*pk);
+		std::vector<double> v(n), d(n);
+		option::put::chain(f, s, std::span<const double>(pk->array, n), v, d, *h_);
+		result.resize(n, 2);
+		for (unsigned i = 0; i < n; ++i) {
+			result(i, 0) = v[i];
+			result(i, 1) = d[i];
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_fre_option_benchmark(
+	Function(XLL_FPX, "xll_fre_option_benchmark", "OPTION.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of puts. Default is 1000000."),
+	})
+	.Volatile()
+	.FunctionHelp("Return nanoseconds per put for the generic normal, black::put::value, and a variate handle.")
+);
+_FPX* WINAPI xll_fre_option_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 3);
+
+	try {
+		if (n <= 0) {
+			n = 1'000'000;
+		}
+
+		const variate::normal v;
+		const variate::nvi& v_ = v;
+		// strikes from 80 to 120
+		auto k = [](LONG i) { return 80 + 40. * i / 1024; };
+
+		result[0] = 1e9 / n * test::timer([n, k]() {
+			double p = 0;
+			for (LONG i = 0; i < n; ++i) {
+				p += option::put::value(100, 0.2, k(i & 1023));
+			}
+			return p;
+		});
+		result[1] = 1e9 / n * test::timer([n, k]() {
+			double p = 0;
+			for (LONG i = 0; i < n; ++i) {
+				p += black::put::value(100, 0.2, k(i & 1023));
+			}
+			return p;
+		});
+		result[2] = 1e9 / n * test::timer([n, k, &v_]() {
+			double p = 0;
+			for (LONG i = 0; i < n; ++i) {
+				p += option::put::value(100, 0.2, k(i & 1023), v_);
+			}
+			return p;
+		});
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
@@ -1,5 +1,7 @@
 // xll_pwflat.cpp - Piecewise flat forward curve
+#include <vector>
 #include "fre_pwflat.h"
+#include "fre_test.h"
 #include "xll_fre.h"
 
 #undef CATEGORY
@@ -10,6 +12,7 @@ using namespace fre;
 
 #ifdef _DEBUG
 //int test_extend = bootstrap::extend_test();
+int test_curve = pwflat::curve_test();
 #endif // _DEBUG
 
 AddIn xai_pwflat_(
@@ -96,9 +99,7 @@ _FPX* WINAPI xll_pwflat_value(HANDLEX curve, _FPX* pt)
 	try {
 		handle<pwflat::curve<>> c(curve);
 		ensure(c);
-		for (unsigned i = 0; i < size(*pt); ++i) {
-			pt->array[i] = c->value(pt->array[i]);
-		}
+		c->values(std::span<const double>(pt->array, size(*pt)), std::span<double>(pt->array, size(*pt)));
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -123,9 +124,7 @@ _FPX* WINAPI xll_pwflat_spot(HANDLEX curve, _FPX* pt)
 	try {
 		handle<pwflat::curve<>> c(curve);
 		ensure(c);
-		for (unsigned i = 0; i < size(*pt); ++i) {
-			pt->array[i] = c->spot(pt->array[i]);
-		}
+		c->spots(std::span<const double>(pt->array, size(*pt)), std::span<double>(pt->array, size(*pt)));
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -150,9 +149,7 @@ _FPX* WINAPI xll_pwflat_discount(HANDLEX curve, _FPX* pt)
 	try {
 		handle<pwflat::curve<>> c(curve);
 		ensure(c);
-		for (unsigned i = 0; i < size(*pt); ++i) {
-			pt->array[i] = c->discount(pt->array[i]);
-		}
+		c->discounts(std::span<const double>(pt->array, size(*pt)), std::span<double>(pt->array, size(*pt)));
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -162,6 +159,60 @@ _FPX* WINAPI xll_pwflat_discount(HANDLEX curve, _FPX* pt)
 	return pt;
 }
 
+AddIn xai_pwflat_benchmark(
+	Function(XLL_FPX, "xll_pwflat_benchmark", CATEGORY ".BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of knots. Default is 200."),
+		Arg(XLL_LONG, "m", "is the number of discount queries. Default is 10000."),
+		})
+		.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return nanoseconds per discount using knot integrals and walking the knots.")
+);
+_FPX* WINAPI xll_pwflat_benchmark(LONG n, LONG m)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) n = 200;
+		if (m <= 0) m = 10000;
+
+		std::vector<double> t(n), f(n), u(m);
+		for (LONG i = 0; i < n; ++i) {
+			t[i] = (i + 1) * 0.25;
+			f[i] = test::uniform(0.01, 0.05);
+		}
+		for (auto& ui : u) {
+			ui = test::uniform(0, t.back() + 5);
+		}
+		pwflat::curve<> c(t, f, 0.03);
+
+		result[0] = test::timer([&]() {
+			double s = 0;
+			for (double ui : u) {
+				s += c.discount(ui);
+			}
+			return s;
+		}, 100);
+		result[1] = test::timer([&]() {
+			double s = 0;
+			for (double ui : u) {
+				s += pwflat::discount(ui, n, t.data(), f.data(), 0.03);
+			}
+			return s;
+		}, 100);
+		result[0] *= 1e9 / m;
+		result[1] *= 1e9 / m;
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+		return 0;
+	}
+
+	return result.get();
+}
+
 #if 0
 AddIn xai_pwflat_discount2(
 	Function(XLL_DOUBLE, "xll_pwflat_discount2", CATEGORY ".CURVE.DISCOUNT2")
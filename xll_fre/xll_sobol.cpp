@@ -0,0 +1,138 @@
+// xll_sobol.cpp - Sobol quasi-Monte Carlo.
+#include "fre_bsm.h"
+#include "fre_sobol.h"
+#include "xll_fre.h"
+
+#undef CATEGORY
+#define CATEGORY "SOBOL"
+
+using namespace fre;
+using namespace xll;
+
+#ifdef _DEBUG
+int test_sobol_sequence = sobol::sequence_test();
+int test_sobol_bridge = sobol::bridge_test();
+int test_sobol_put = sobol::put_test();
+#endif // _DEBUG
+
+AddIn xai_sobol_sequence(
+	Function(XLL_FPX, "xll_sobol_sequence", CATEGORY ".SEQUENCE")
+	.Arguments({
+		Arg(XLL_LONG, "d", "is the dimension, at most 1024."),
+		Arg(XLL_LONG, "n", "is the number of points."),
+		Arg(XLL_LONG, "seed", "is an optional Owen scrambling seed. Default is no scrambling."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return n rows of d dimensional Sobol points.")
+);
+_FPX* WINAPI xll_sobol_sequence(LONG d, LONG n, LONG seed)
+{
+#pragma XLLEXPORT
+	static FPX result;
+
+	try {
+		ensure(d > 0 && n > 0);
+
+		sobol::sequence s = seed ? sobol::sequence(d, static_cast<uint32_t>(seed)) : sobol::sequence(d);
+		result.resize(n, d);
+		for (LONG i = 0; i < n; ++i) {
+			s.next(std::span<double>(result.get()->array + size_t(i) * d, d));
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_sobol_put_value(
+	Function(XLL_FPX, "xll_sobol_put_value", CATEGORY ".PUT.VALUE")
+	.Arguments({
+		Arg(XLL_DOUBLE, "r", "is the continuously compounded interest rate."),
+		Arg(XLL_DOUBLE, "S0", "is the spot price."),
+		Arg(XLL_DOUBLE, "sigma", "is the volatility."),
+		Arg(XLL_DOUBLE, "k", "is the strike."),
+		Arg(XLL_DOUBLE, "t", "is the time in years to expiration."),
+		Arg(XLL_LONG, "n", "is the number of points per replicate. Default is 4096."),
+		Arg(XLL_LONG, "steps", "is the number of path steps. Default is 1."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return the BSM put value and standard error from 16 scrambled Sobol replicates.")
+);
+_FPX* WINAPI xll_sobol_put_value(double r, double S0, double sigma, double k, double t, LONG n, LONG steps)
+{
+#pragma XLLEXPORT
+	static FPX result(1, 2);
+
+	try {
+		if (n <= 0) {
+			n = 4096;
+		}
+		if (steps <= 0) {
+			steps = 1;
+		}
+
+		auto v = sobol::put::value(r, S0, sigma, k, t, n, steps);
+		result[0] = v.mean;
+		result[1] = v.error();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
+
+AddIn xai_sobol_benchmark(
+	Function(XLL_FPX, "xll_sobol_benchmark", CATEGORY ".BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "steps", "is the number of path steps. Default is 8."),
+		})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return rows of sample count, Sobol RMS error and pseudo-random RMS error for an at-the-money BSM put.")
+);
+_FPX* WINAPI xll_sobol_benchmark(LONG steps)
+{
+#pragma XLLEXPORT
+	static FPX result(6, 3);
+
+	try {
+		if (steps <= 0) {
+			steps = 8;
+		}
+
+		const double r = 0.05, S0 = 100, sigma = 0.2, k = 100, t = 1;
+		const auto [R, f, s] = bsm::bsm_to_black(r, S0, sigma, t);
+		const double v = black::put::value(f, s, k) / R;
+
+		// RMS error over 16 replicates is sqrt(variance + bias^2)
+		auto rms = [v](const monte_carlo::statistics& e) {
+			return sqrt(e.variance() + (e.mean - v) * (e.mean - v));
+		};
+
+		size_t n = 256;
+		for (unsigned i = 0; i < 6; ++i, n *= 4) {
+			monte_carlo::statistics p;
+			for (uint64_t seed = 1; seed <= 16; ++seed) {
+				p.add(monte_carlo::put::value(f, s, k, n, seed).mean / R);
+			}
+
+			result(i, 0) = static_cast<double>(n);
+			result(i, 1) = rms(sobol::put::value(r, S0, sigma, k, t, n, steps));
+			result(i, 2) = rms(p);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
+}
@@ -1,35 +1,103 @@
 // xll_variate.cpp - Generic random variate.
+#include <vector>
+#include "fre_test.h"
 #include "fre_variate.h"
 #include "xll_fre.h"
 
 using namespace xll;
 using namespace fre;
 
+#ifdef _DEBUG
+int test_generate = variate::generate_test();
+int test_discrete = variate::discrete_test();
+#endif // _DEBUG
+
 AddIn xai_fre_variate_gen(
-	Function(XLL_DOUBLE, "xll_fre_variate_gen", "VARIATE.GEN")
+	Function(XLL_FPX, "xll_fre_variate_gen", "VARIATE.GEN")
 	.Arguments({
-		Arg(XLL_HANDLEX, "handle", "is a handle to a variate.")
+		Arg(XLL_HANDLEX, "handle", "is a handle to a variate."),
+		Arg(XLL_LONG, "n", "is the optional number of variates. Default is 1."),
 	})
 	.Category(CATEGORY)
 	.Volatile()
-	.FunctionHelp("Return a random variate.")
+	.FunctionHelp("Return a column of random variates.")
 );
-double WINAPI xll_fre_variate_gen(HANDLEX h)
+_FPX* WINAPI xll_fre_variate_gen(HANDLEX h, LONG n)
 {
 #pragma XLLEXPORT
-	double result = std::numeric_limits<double>::quiet_NaN();
+	static FPX result;
 
 	try {
 		handle<variate::nvi> h_(h);
 		ensure(h_);
 
-		result = (*h_)();
+		if (n <= 0) {
+			n = 1;
+		}
+		result.resize(n, 1);
+		if (n == 1) {
+			result[0] = (*h_)();
+		}
+		else {
+			h_->generate(std::span<double>(result.get()->array, n));
+		}
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
+
+		return 0;
 	}
 		
-	return result;
+	return result.get();
+}
+
+AddIn xai_fre_variate_benchmark(
+	Function(XLL_FPX, "xll_fre_variate_benchmark", "VARIATE.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "n", "is the number of variates. Default is 1000000."),
+	})
+	.Category(CATEGORY)
+	.Volatile()
+	.FunctionHelp("Return samples per second for normal and discrete variates one at a time and in blocks.")
+);
+_FPX* WINAPI xll_fre_variate_benchmark(LONG n)
+{
+#pragma XLLEXPORT
+	static FPX result(2, 2);
+
+	try {
+		if (n <= 0) {
+			n = 1'000'000;
+		}
+
+		std::vector<double> x(n);
+		double a[] = { -1, 0, 1 };
+		double p[] = { 0.25, 0.5, 0.25 };
+		variate::normal v0;
+		variate::discrete v1(3, a, p);
+		variate::nvi* vs[] = { &v0, &v1 };
+
+		for (int i = 0; i < 2; ++i) {
+			variate::nvi& v = *vs[i];
+			result(i, 0) = n / test::timer([&]() {
+				for (double& xi : x) {
+					xi = v();
+				}
+				return x.back();
+			});
+			result(i, 1) = n / test::timer([&]() {
+				v.generate(x);
+				return x.back();
+			});
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return 0;
+	}
+
+	return result.get();
 }
 
 AddIn xai_fre_variate_normal(